@@ -0,0 +1,198 @@
+/**
+ * @file bench_buffer_idle.cpp
+ * @brief CPU usage of the pipeline's thread structure while it is mostly idle
+ *
+ * The pipeline runs `NUM_WORKERS` inference core threads that wait for the
+ * frame timer, do some work and then push their results into a
+ * `Buffer::SequencedRing` that a single post processing thread pops from. At
+ * low frame rates these threads spend almost all of their time waiting, so the
+ * CPU time used is dominated by how the buffer waits.
+ *
+ * This benchmark reproduces that structure, with inference replaced by a sleep
+ * so that only the waiting is measured. It compares the spin-waiting buffer
+ * and the `LockBuffer` the pipeline used previously with the current
+ * `Buffer::SequencedRing` at 1Hz and 20Hz.
+ *
+ * Usage: `bench_buffer_idle [seconds per run]`
+ *
+ * @copyright Copyright (C) 2021  Miklas Riechmann
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <atomic>
+#include <chrono>  //NOLINT [build/c++11]
+#include <mutex>   //NOLINT [build/c++11]
+#include <thread>  //NOLINT [build/c++11]
+#include <vector>
+
+#include "../src/buffer.h"
+#include "bench_common.h"
+#include "lock_buffer.h"
+
+#define NUM_WORKERS 8         ///< Matches `NUM_INF_CORE_THREADS` in `main.cpp`
+#define INFERENCE_TIME_MS 30  ///< Simulated time to run inference on a frame
+#define DEFAULT_RUN_TIME_S 5
+
+/**
+ * @brief The spin-waiting buffer the pipeline used previously, kept here as a
+ * baseline
+ *
+ */
+template <typename T>
+class SpinBuffer {
+ private:
+  std::mutex lock_in;
+  std::mutex lock_out;
+  std::vector<T> queue;
+  size_t front_index = 0;
+  size_t back_index = 0;
+  bool* running;
+  uint8_t id = -1;
+  bool full = false;
+
+  size_t size(void) {
+    int size = back_index - front_index;
+    if (size < 0) {
+      return (queue.size() + size);
+    }
+    return size;
+  }
+
+ public:
+  SpinBuffer(bool* running_ptr, size_t max_size)
+      : queue(max_size), running(running_ptr) {}
+
+  void push(T frame) {
+    while (*running) {
+      lock_in.lock();
+      if ((uint8_t)(id + 1) == (uint8_t)frame.id && !full) {
+        queue.at(back_index) = frame;
+        back_index = (back_index + 1) % queue.size();
+        if (back_index == front_index) {
+          full = true;
+        }
+        id++;
+        lock_in.unlock();
+        break;
+      }
+      lock_in.unlock();
+    }
+  }
+
+  Buffer::PopResult<T> pop() {
+    Buffer::PopResult<T> front = Buffer::PopResult<T>{T{}, false};
+    while (*running) {
+      lock_out.lock();
+      if (size() != 0 || full) {
+        front = Buffer::PopResult<T>{queue.at(front_index), true};
+        front_index = (front_index + 1) % queue.size();
+        full = false;
+        lock_out.unlock();
+        break;
+      }
+      lock_out.unlock();
+    }
+    return front;
+  }
+
+  void stop(void) {}
+};
+
+/**
+ * @brief Run the simulated pipeline for `run_time_s` seconds
+ *
+ * @return `double` CPU usage as a percentage of a single core
+ */
+template <typename B>
+double run(B* buffer, bool* running, size_t frame_delay_ms, int run_time_s) {
+  Ticker<Frame> ticker;
+  std::atomic<size_t> frames_out(0);
+  std::vector<std::thread> threads;
+
+  for (int i = 0; i < NUM_WORKERS; i++) {
+    threads.push_back(std::thread([&] {
+      Frame frame;
+      while (*running && ticker.next_frame(&frame)) {
+        std::this_thread::sleep_for(
+            std::chrono::milliseconds(INFERENCE_TIME_MS));
+        buffer->push(frame);
+      }
+    }));
+  }
+  threads.push_back(std::thread([&] {
+    while (*running) {
+      if (!buffer->pop().valid) {
+        break;
+      }
+      frames_out++;
+    }
+  }));
+
+  auto start = std::chrono::steady_clock::now();
+  auto end = start + std::chrono::seconds(run_time_s);
+  double cpu_start = cpu_seconds();
+  for (auto t = start; t < end;
+       t += std::chrono::milliseconds(frame_delay_ms)) {
+    std::this_thread::sleep_until(t);
+    ticker.tick();
+  }
+  std::this_thread::sleep_until(end);
+  double cpu_used = cpu_seconds() - cpu_start;
+
+  *running = false;
+  ticker.stop();
+  buffer->stop();
+  for (auto& t : threads) {
+    t.join();
+  }
+
+  printf("    %zu frames out\n", frames_out.load());
+  return 100.0 * cpu_used / run_time_s;
+}
+
+int main(int argc, char* argv[]) {
+  int run_time_s = (argc > 1) ? atoi(argv[1]) : DEFAULT_RUN_TIME_S;
+  size_t frame_delays_ms[] = {1000, 50};
+
+  printf("%d workers, %dms simulated inference, %ds per run\n", NUM_WORKERS,
+         INFERENCE_TIME_MS, run_time_s);
+
+  for (auto frame_delay_ms : frame_delays_ms) {
+    float hz = 1000.0 / frame_delay_ms;
+    bool running = true;
+
+    SpinBuffer<Frame> spin_buffer(&running, NUM_WORKERS);
+    printf("%4.1fHz spin-waiting buffer:\n", hz);
+    printf("    %.1f%% CPU\n",
+           run(&spin_buffer, &running, frame_delay_ms, run_time_s));
+
+    running = true;
+    LockBuffer<Frame> lock_buffer(NUM_WORKERS);
+    printf("%4.1fHz LockBuffer:\n", hz);
+    printf("    %.1f%% CPU\n",
+           run(&lock_buffer, &running, frame_delay_ms, run_time_s));
+
+    running = true;
+    Buffer::SequencedRing<Frame> ring(NUM_WORKERS);
+    printf("%4.1fHz Buffer::SequencedRing:\n", hz);
+    printf("    %.1f%% CPU\n",
+           run(&ring, &running, frame_delay_ms, run_time_s));
+  }
+  return 0;
+}
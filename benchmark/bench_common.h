@@ -0,0 +1,109 @@
+/**
+ * @file bench_common.h
+ * @brief Helpers shared between the benchmarks
+ *
+ * @copyright Copyright (C) 2021  Miklas Riechmann
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef BENCHMARK_BENCH_COMMON_H_
+#define BENCHMARK_BENCH_COMMON_H_
+
+#include <stdint.h>
+#include <time.h>
+
+#include <algorithm>
+#include <chrono>              //NOLINT [build/c++11]
+#include <condition_variable>  //NOLINT [build/c++11]
+#include <mutex>               //NOLINT [build/c++11]
+#include <vector>
+
+/**
+ * @brief Minimal element type for benchmarking the buffers
+ *
+ */
+struct Frame {
+  uint64_t id;
+  std::chrono::steady_clock::time_point pushed;
+};
+
+/**
+ * @brief Stand-in for `Pipeline::FrameGenerator`: hands out one frame ID per
+ * timer tick
+ *
+ */
+template <typename F>
+class Ticker {
+ private:
+  std::mutex mutex;
+  std::condition_variable cv;
+  uint64_t id = 0;
+  size_t pending = 0;
+  bool stopped = false;
+
+ public:
+  void tick(void) {
+    std::unique_lock<std::mutex> lock(mutex);
+    pending++;
+    cv.notify_one();
+  }
+
+  bool next_frame(F* frame) {
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait(lock, [this] { return stopped || pending > 0; });
+    if (stopped) {
+      return false;
+    }
+    pending--;
+    frame->id = id++;
+    return true;
+  }
+
+  void stop(void) {
+    std::unique_lock<std::mutex> lock(mutex);
+    stopped = true;
+    cv.notify_all();
+  }
+};
+
+/**
+ * @brief CPU time used by the whole process so far
+ *
+ * @return `double` CPU time in seconds
+ */
+inline double cpu_seconds(void) {
+  timespec ts;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/**
+ * @brief Get the given percentile of a set of samples
+ *
+ * @param samples Samples; these are sorted in place
+ * @param percentile Percentile in the range [0..100]
+ */
+template <typename S>
+S percentile(std::vector<S>* samples, double percentile) {
+  if (samples->empty()) {
+    return S{};
+  }
+  std::sort(samples->begin(), samples->end());
+  size_t index = (samples->size() - 1) * percentile / 100.0;
+  return samples->at(index);
+}
+
+#endif  // BENCHMARK_BENCH_COMMON_H_
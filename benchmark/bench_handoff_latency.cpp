@@ -0,0 +1,114 @@
+/**
+ * @file bench_handoff_latency.cpp
+ * @brief Latency of handing results from the inference core threads to the
+ * post processing thread
+ *
+ * `NUM_WORKERS` threads take frames at 20Hz, simulate inference with a sleep
+ * of varying length (so that results arrive out of order) and push them to a
+ * buffer. The consumer measures the time from each `push()` call to the
+ * matching `pop()` returning. Only frames that were already next in line when
+ * pushed are counted, so the time spent waiting for a slower, earlier frame
+ * is excluded and only the cost of the handoff itself remains.
+ *
+ * Usage: `bench_handoff_latency [seconds per run]`
+ *
+ * @copyright Copyright (C) 2021  Miklas Riechmann
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <atomic>
+#include <chrono>  //NOLINT [build/c++11]
+#include <thread>  //NOLINT [build/c++11]
+#include <vector>
+
+#include "../src/buffer.h"
+#include "bench_common.h"
+#include "lock_buffer.h"
+
+#define NUM_WORKERS 8          ///< Matches `NUM_INF_CORE_THREADS` in `main.cpp`
+#define FRAME_DELAY_MS 50      ///< 20Hz, the fastest frame rate
+#define MIN_INFERENCE_MS 100   ///< Shortest simulated inference
+#define INFERENCE_JITTER_MS 7  ///< Spread of simulated inference times
+#define DEFAULT_RUN_TIME_S 5
+
+template <typename B>
+void run(const char* name, B* buffer, int run_time_s) {
+  Ticker<Frame> ticker;
+  std::atomic<bool> running(true);
+  std::vector<double> latencies_us;
+  std::vector<std::thread> threads;
+
+  for (int i = 0; i < NUM_WORKERS; i++) {
+    threads.push_back(std::thread([&, i] {
+      Frame frame;
+      while (running && ticker.next_frame(&frame)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(
+            MIN_INFERENCE_MS + (frame.id * 5 + i) % INFERENCE_JITTER_MS));
+        frame.pushed = std::chrono::steady_clock::now();
+        buffer->push(frame);
+      }
+    }));
+  }
+  threads.push_back(std::thread([&] {
+    while (running) {
+      auto result = buffer->pop();
+      auto popped = std::chrono::steady_clock::now();
+      if (!result.valid) {
+        break;
+      }
+      // Skip frames that had to wait for an earlier one
+      if (result.value.pushed > popped - std::chrono::milliseconds(1)) {
+        latencies_us.push_back(
+            std::chrono::duration<double, std::micro>(popped -
+                                                      result.value.pushed)
+                .count());
+      }
+    }
+  }));
+
+  auto start = std::chrono::steady_clock::now();
+  auto end = start + std::chrono::seconds(run_time_s);
+  for (auto t = start; t < end;
+       t += std::chrono::milliseconds(FRAME_DELAY_MS)) {
+    std::this_thread::sleep_until(t);
+    ticker.tick();
+  }
+
+  running = false;
+  ticker.stop();
+  buffer->stop();
+  for (auto& t : threads) {
+    t.join();
+  }
+
+  printf("%s: %zu samples, p50 %.1fus, p99 %.1fus\n", name,
+         latencies_us.size(), percentile(&latencies_us, 50),
+         percentile(&latencies_us, 99));
+}
+
+int main(int argc, char* argv[]) {
+  int run_time_s = (argc > 1) ? atoi(argv[1]) : DEFAULT_RUN_TIME_S;
+
+  LockBuffer<Frame> buffer(NUM_WORKERS);
+  run("LockBuffer           ", &buffer, run_time_s);
+
+  Buffer::SequencedRing<Frame> ring(NUM_WORKERS);
+  run("Buffer::SequencedRing", &ring, run_time_s);
+  return 0;
+}
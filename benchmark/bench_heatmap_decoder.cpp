@@ -0,0 +1,125 @@
+/**
+ * @file bench_heatmap_decoder.cpp
+ * @brief Time taken to find each body part in the model's output heatmap
+ *
+ * Compares the original loop from `Inference::InferenceCore::run()`, which
+ * compares and branches on every value, with each `Inference::argmax()`
+ * kernel this CPU supports, on a random heatmap of the model's output size.
+ * The same heatmap quantised to `uint8_t` is then searched with each
+ * `Inference::argmax_quantised()` kernel.
+ *
+ * Usage: `bench_heatmap_decoder [iterations]`
+ *
+ * @copyright Copyright (C) 2021  Miklas Riechmann
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>  //NOLINT [build/c++11]
+#include <vector>
+
+#include "../src/heatmap_decoder.h"
+#include "../src/intermediate_structures.h"
+#include "bench_common.h"
+
+#define MODEL_OUTPUT_X 224
+#define MODEL_OUTPUT_Y 224
+#define DEFAULT_ITERATIONS 500
+
+/**
+ * @brief The search in `InferenceCore::run` before it was vectorised
+ *
+ */
+void decode_original(const float* output, size_t width, size_t height,
+                     Inference::Result* results) {
+  memset(results, 0, sizeof(Inference::Result) * (BodyPartMax + 1));
+  size_t size = width * height;
+  size_t step = BodyPartMax + 1;
+  for (uint32_t i = 0; i < size * step; i += step) {
+    for (int body_part = BodyPartMin; body_part <= BodyPartMax; body_part++) {
+      float out = output[i + body_part];
+      if (out > results[body_part].confidence) {
+        results[body_part] = {out, (i / step) % width, (i / step) / height};
+      }
+    }
+  }
+}
+
+template <typename F>
+void run(const char* name, int iterations, F f) {
+  std::vector<double> samples;
+  for (int i = 0; i < iterations; i++) {
+    auto start = std::chrono::steady_clock::now();
+    f();
+    samples.push_back(std::chrono::duration<double, std::micro>(
+                          std::chrono::steady_clock::now() - start)
+                          .count());
+  }
+  printf("%-10s p50 %7.1fus, p99 %7.1fus\n", name, percentile(&samples, 50),
+         percentile(&samples, 99));
+}
+
+int main(int argc, char* argv[]) {
+  int iterations = (argc > 1) ? atoi(argv[1]) : DEFAULT_ITERATIONS;
+  size_t num_pixels = MODEL_OUTPUT_X * MODEL_OUTPUT_Y;
+
+  // Mostly low values with the odd peak, like a real heatmap
+  std::vector<float> heatmap(num_pixels * HEATMAP_CHANNELS);
+  for (auto& value : heatmap) {
+    value = (rand() % 1000) / 1000.0f;  // NOLINT [runtime/threadsafe_fn]
+    value *= value * value;
+  }
+
+  printf("%dx%d pixels, %d channels, %d iterations\n", MODEL_OUTPUT_X,
+         MODEL_OUTPUT_Y, HEATMAP_CHANNELS, iterations);
+  Inference::Result results[BodyPartMax + 1];
+  run("Original", iterations, [&] {
+    decode_original(heatmap.data(), MODEL_OUTPUT_X, MODEL_OUTPUT_Y, results);
+  });
+
+  const char* names[] = {"Scalar", "SSE4.1", "AVX2", "NEON"};
+  Inference::ArgmaxKernel kernels[] = {
+      Inference::ArgmaxScalar, Inference::ArgmaxSSE41, Inference::ArgmaxAVX2,
+      Inference::ArgmaxNEON};
+  float max[HEATMAP_CHANNELS];
+  uint32_t index[HEATMAP_CHANNELS];
+  for (int k = 0; k < 4; k++) {
+    if (Inference::argmax_supported(kernels[k])) {
+      run(names[k], iterations, [&] {
+        Inference::argmax(kernels[k], heatmap.data(), num_pixels, max, index);
+      });
+    }
+  }
+
+  printf("Quantised to uint8\n");
+  std::vector<uint8_t> quantised(heatmap.size());
+  for (size_t i = 0; i < heatmap.size(); i++) {
+    quantised[i] = heatmap[i] * 255;
+  }
+  int32_t quantised_max[HEATMAP_CHANNELS];
+  for (int k = 0; k < 4; k++) {
+    if (Inference::argmax_supported(kernels[k])) {
+      run(names[k], iterations, [&] {
+        Inference::argmax_quantised(kernels[k], quantised.data(), num_pixels,
+                                    UInt8Tensor, 0, quantised_max, index);
+      });
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,149 @@
+/**
+ * @file bench_latest_slot.cpp
+ * @brief Latency of publishing and reading the latest frame
+ *
+ * One writer publishes frames as fast as it can while `NUM_READERS` threads
+ * read the latest frame as fast as they can, which is far more contention
+ * than the `FrameGenerator` sees but shows how each side is affected by the
+ * other. Frames are held by `std::shared_ptr`, which like `cv::Mat` is
+ * reference counted, so copying one costs about the same.
+ *
+ * Compares a value protected by a mutex, as `FrameGenerator` used previously,
+ * with `Buffer::LatestSlot`.
+ *
+ * Usage: `bench_latest_slot [seconds per run]`
+ *
+ * @copyright Copyright (C) 2021  Miklas Riechmann
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <atomic>
+#include <chrono>  //NOLINT [build/c++11]
+#include <memory>
+#include <mutex>   //NOLINT [build/c++11]
+#include <thread>  //NOLINT [build/c++11]
+#include <vector>
+
+#include "../src/buffer.h"
+#include "bench_common.h"
+
+#define NUM_READERS 8  ///< Matches `NUM_INF_CORE_THREADS` in `main.cpp`
+#define SAMPLE_EVERY 64  ///< Only time one in this many operations
+#define DEFAULT_RUN_TIME_S 2
+
+typedef std::shared_ptr<Frame> FramePtr;
+
+/**
+ * @brief The mutex-protected frame the `FrameGenerator` used previously, kept
+ * here as a baseline
+ *
+ */
+class MutexSlot {
+ private:
+  std::mutex mutex;
+  FramePtr value;
+
+ public:
+  explicit MutexSlot(size_t) {}
+
+  void publish(FramePtr frame) {
+    std::unique_lock<std::mutex> lock(mutex);
+    value = std::move(frame);
+  }
+
+  FramePtr read(void) {
+    std::unique_lock<std::mutex> lock(mutex);
+    return value;
+  }
+};
+
+/**
+ * @brief Time a single call of `f`, in ns
+ *
+ */
+template <typename F>
+double time_ns(F f) {
+  auto start = std::chrono::steady_clock::now();
+  f();
+  return std::chrono::duration<double, std::nano>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+template <typename S>
+void run(const char* name, int run_time_s) {
+  S slot(NUM_READERS);
+  std::atomic<bool> running(true);
+  std::vector<std::vector<double>> read_samples(NUM_READERS);
+  std::vector<double> publish_samples;
+  std::atomic<uint64_t> reads(0);
+  uint64_t publishes = 0;
+
+  std::vector<std::thread> readers;
+  for (int r = 0; r < NUM_READERS; r++) {
+    readers.push_back(std::thread([&, r] {
+      uint64_t count = 0;
+      while (running) {
+        if (count++ % SAMPLE_EVERY == 0) {
+          read_samples.at(r).push_back(time_ns([&] { slot.read(); }));
+        } else {
+          slot.read();
+        }
+      }
+      reads += count;
+    }));
+  }
+
+  auto end =
+      std::chrono::steady_clock::now() + std::chrono::seconds(run_time_s);
+  while (std::chrono::steady_clock::now() < end) {
+    FramePtr frame(new Frame{publishes, std::chrono::steady_clock::now()});
+    if (publishes++ % SAMPLE_EVERY == 0) {
+      publish_samples.push_back(
+          time_ns([&] { slot.publish(std::move(frame)); }));
+    } else {
+      slot.publish(std::move(frame));
+    }
+  }
+  running = false;
+  for (auto& t : readers) {
+    t.join();
+  }
+
+  std::vector<double> all_reads;
+  for (auto& samples : read_samples) {
+    all_reads.insert(all_reads.end(), samples.begin(), samples.end());
+  }
+  printf("%s:\n", name);
+  printf("    publish: %.1f M/s, p50 %.0fns, p99 %.0fns\n",
+         publishes / 1e6 / run_time_s, percentile(&publish_samples, 50),
+         percentile(&publish_samples, 99));
+  printf("    read:    %.1f M/s, p50 %.0fns, p99 %.0fns\n",
+         reads.load() / 1e6 / run_time_s, percentile(&all_reads, 50),
+         percentile(&all_reads, 99));
+}
+
+int main(int argc, char* argv[]) {
+  int run_time_s = (argc > 1) ? atoi(argv[1]) : DEFAULT_RUN_TIME_S;
+
+  printf("1 writer, %d readers, %ds per run\n", NUM_READERS, run_time_s);
+  run<MutexSlot>("Mutex", run_time_s);
+  run<Buffer::LatestSlot<FramePtr>>("Buffer::LatestSlot", run_time_s);
+  return 0;
+}
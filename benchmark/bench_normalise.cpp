@@ -0,0 +1,97 @@
+/**
+ * @file bench_normalise.cpp
+ * @brief Time taken to normalise a model input image
+ *
+ * Compares the original per-pixel loop, which converts every channel through a
+ * `double`, with each `PreProcessing::normalise()` kernel this CPU supports,
+ * on a random image of the model's input size.
+ *
+ * Usage: `bench_normalise [iterations]`
+ *
+ * @copyright Copyright (C) 2021  Miklas Riechmann
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <chrono>  //NOLINT [build/c++11]
+#include <vector>
+
+#include "../src/normalise.h"
+#include "bench_common.h"
+
+#define MODEL_INPUT_X 224
+#define MODEL_INPUT_Y 224
+#define DEFAULT_ITERATIONS 2000
+
+/**
+ * @brief `PreProcessor::normalise` before it was vectorised
+ *
+ */
+void normalise_original(const uint8_t* resized_image, float* normalised_image,
+                        size_t num_pixels) {
+  for (size_t i = 0; i < num_pixels * 3; i += 3) {
+    const uint8_t* img = &(resized_image[i]);
+    normalised_image[i + 0] = img[2] / 127.5 - 1;
+    normalised_image[i + 1] = img[1] / 127.5 - 1;
+    normalised_image[i + 2] = img[0] / 127.5 - 1;
+  }
+}
+
+template <typename F>
+void run(const char* name, int iterations, F f) {
+  std::vector<double> samples;
+  for (int i = 0; i < iterations; i++) {
+    auto start = std::chrono::steady_clock::now();
+    f();
+    samples.push_back(std::chrono::duration<double, std::micro>(
+                          std::chrono::steady_clock::now() - start)
+                          .count());
+  }
+  printf("%-10s p50 %7.1fus, p99 %7.1fus\n", name, percentile(&samples, 50),
+         percentile(&samples, 99));
+}
+
+int main(int argc, char* argv[]) {
+  int iterations = (argc > 1) ? atoi(argv[1]) : DEFAULT_ITERATIONS;
+  size_t num_pixels = MODEL_INPUT_X * MODEL_INPUT_Y;
+
+  std::vector<uint8_t> bgr(num_pixels * 3);
+  for (auto& value : bgr) {
+    value = rand() % 256;  // NOLINT [runtime/threadsafe_fn]
+  }
+  std::vector<float> rgb(num_pixels * 3);
+
+  printf("%dx%d pixels, %d iterations\n", MODEL_INPUT_X, MODEL_INPUT_Y,
+         iterations);
+  run("Original", iterations,
+      [&] { normalise_original(bgr.data(), rgb.data(), num_pixels); });
+
+  const char* names[] = {"Scalar", "SSE4.1", "AVX2", "NEON"};
+  PreProcessing::NormaliseKernel kernels[] = {
+      PreProcessing::NormaliseScalar, PreProcessing::NormaliseSSE41,
+      PreProcessing::NormaliseAVX2, PreProcessing::NormaliseNEON};
+  for (int k = 0; k < 4; k++) {
+    if (PreProcessing::normalise_supported(kernels[k])) {
+      run(names[k], iterations, [&] {
+        PreProcessing::normalise(kernels[k], bgr.data(), rgb.data(),
+                                 num_pixels);
+      });
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,120 @@
+/**
+ * @file bench_pipeline.cpp
+ * @brief Throughput and CPU usage of the full pipeline under a repeatable load
+ *
+ * Runs `Pipeline::Pipeline` with the real model, fed by a
+ * `FrameSource::Synthetic` source instead of a camera so that it can run on
+ * machines without one. The pipeline is set to its highest frame rate and the
+ * number of frames coming out of it per second is measured, together with the
+ * CPU time used and the counters of its internal queue.
+ *
+ * By default the source replays random 640x480 frames at 30Hz, like a webcam.
+ * Passing a directory replays the images in it instead.
+ *
+ * Set `POSTURE_INFERENCE_THREADS` as for `PosturePerfection`, e.g. to `1x4`,
+ * to compare inference core threads with threads per core. Set
+ * `POSTURE_INFERENCE_BATCH` to have each inference core thread run the model
+ * on that many frames at once.
+ *
+ * Must be run from the repository root so that the model in `assets/` is found.
+ *
+ * Usage: `bench_pipeline [seconds] [image directory]`
+ *
+ * @copyright Copyright (C) 2021  Miklas Riechmann
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <atomic>
+#include <chrono>  //NOLINT [build/c++11]
+#include <memory>
+#include <thread>  //NOLINT [build/c++11]
+
+#include "../src/frame_source.h"
+#include "../src/pipeline.h"
+#include "bench_common.h"
+
+#define NUM_INF_CORE_THREADS 8  ///< Matches `main.cpp`
+#define SOURCE_FRAME_DELAY 33   ///< Delay between source frames in ms, ~30Hz
+#define DEFAULT_RUN_TIME_S 10
+
+std::atomic<size_t> frames_out(0);
+
+void frame_callback(PostureEstimating::PoseStatus, cv::Mat) { frames_out++; }
+
+int main(int argc, char* argv[]) {
+  int run_time_s = (argc > 1) ? atoi(argv[1]) : DEFAULT_RUN_TIME_S;
+
+  std::unique_ptr<FrameSource::FrameSource> source;
+  if (argc > 2) {
+    source.reset(new FrameSource::ImageSequence(argv[2], SOURCE_FRAME_DELAY));
+  } else {
+    source.reset(new FrameSource::Synthetic(
+        FrameSource::Synthetic::noise(cv::Size(640, 480), 30),
+        SOURCE_FRAME_DELAY));
+  }
+
+  unsigned int num_cores = NUM_INF_CORE_THREADS;
+  unsigned int threads_per_core = 1;
+  const char* inference_threads = getenv("POSTURE_INFERENCE_THREADS");
+  if (inference_threads != NULL &&
+      (sscanf(inference_threads, "%ux%u", &num_cores, &threads_per_core) != 2 ||
+       num_cores < 1 || num_cores > UINT8_MAX || threads_per_core < 1 ||
+       threads_per_core > UINT8_MAX)) {
+    fprintf(stderr,
+            "POSTURE_INFERENCE_THREADS must look like 8x1, with both numbers "
+            "from 1 to 255\n");
+    return EXIT_FAILURE;
+  }
+  const char* inference_batch = getenv("POSTURE_INFERENCE_BATCH");
+  unsigned int batch_size = inference_batch ? atoi(inference_batch) : 1;
+  if (batch_size < 1 || batch_size > UINT8_MAX) {
+    fprintf(stderr, "POSTURE_INFERENCE_BATCH must be from 1 to 255\n");
+    return EXIT_FAILURE;
+  }
+
+  Pipeline::Pipeline pipeline(num_cores, &frame_callback, std::move(source),
+                              Buffer::Block, Pipeline::DecodeAll,
+                              threads_per_core, batch_size);
+
+  // Go to the highest frame rate the pipeline supports
+  float framerate = pipeline.get_framerate();
+  while (pipeline.increase_framerate() != framerate) {
+    framerate = pipeline.get_framerate();
+  }
+  printf("%u inference core threads x %u, batches of %u, %.1fHz, %ds\n",
+         num_cores, threads_per_core, batch_size, framerate, run_time_s);
+
+  // Let the pipeline fill up before measuring
+  std::this_thread::sleep_for(std::chrono::seconds(1));
+  size_t frames_start = frames_out;
+  double cpu_start = cpu_seconds();
+  std::this_thread::sleep_for(std::chrono::seconds(run_time_s));
+  double cpu_used = cpu_seconds() - cpu_start;
+  size_t frames = frames_out - frames_start;
+
+  Buffer::Stats stats = pipeline.get_core_results_stats();
+  printf("    %.2f frames/s out\n", static_cast<double>(frames) / run_time_s);
+  printf("    %.1f%% CPU\n", 100.0 * cpu_used / run_time_s);
+  printf("    %" PRIu64 " lost, %" PRIu64 " dropped, %" PRIu64
+         " producer waits\n",
+         stats.lost, stats.dropped, stats.producer_waits);
+  return 0;
+}
@@ -0,0 +1,241 @@
+/**
+ * @file lock_buffer.h
+ * @brief Baseline reorder buffer for the buffer benchmarks
+ *
+ * @copyright Copyright (C) 2021  Miklas Riechmann
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef BENCHMARK_LOCK_BUFFER_H_
+#define BENCHMARK_LOCK_BUFFER_H_
+
+#include <stdint.h>
+
+#include <condition_variable>  //NOLINT [build/c++11]
+#include <mutex>               //NOLINT [build/c++11]
+#include <utility>
+#include <vector>
+
+#include "../src/buffer.h"
+
+/**
+ * @brief The mutex based reorder buffer the pipeline used before
+ * `Buffer::SequencedRing`, kept as a baseline for the benchmarks
+ *
+ * The buffer ensures that elements are in order based on the element's `id`
+ * field. Attempting to `push` an element that is not next in line will block
+ * until the missing element has been pushed by a different thread. An object of
+ * this class may therefore be used to share the load at any stage in a pipeline
+ * between multiple threads without needing to worry about issues in the order
+ * of elements.
+ *
+ * Waiting threads are parked on condition variables rather than polling.
+ * Producers wait on the condition variable belonging to their element's `id`,
+ * so that when an `id` is pushed only the producer holding the following `id`
+ * is woken up. The consumer has a condition variable of its own.
+ *
+ * It is implemented as a circular buffer.
+ *
+ * @tparam T The type for elements in the buffer. This must provide an `id`
+ * field that is a `uint64_t`, starting from zero.
+ */
+template <typename T>
+class LockBuffer {
+ private:
+  std::mutex mutex;      ///< Protects all of the state below
+  std::vector<T> queue;  ///< Underlying queueing mechanism
+
+  /**
+   * @brief Condition variable the consumer waits on until an element is
+   * available
+   *
+   */
+  std::condition_variable not_empty;
+
+  /**
+   * @brief Condition variables producers wait on until it is their turn
+   *
+   * A producer pushing an element with a given `id` waits on the entry at
+   * `id % queue.size()`.
+   *
+   */
+  std::vector<std::condition_variable> turn;
+
+  size_t front_index = 0;  ///< Front (next to be popped) of the buffer
+  size_t back_index = 0;   ///< Back (where to push) of the buffer
+  size_t count = 0;        ///< Number of elements in the buffer
+
+  /**
+   * @brief Flag to indicate the buffer has been stopped
+   *
+   * When this becomes `true` any blocked threads are woken up and return
+   *
+   */
+  bool stopped = false;
+
+  /**
+   * @brief ID number for the newest frame on the queue
+   *
+   * The next frame that will be added to the queue will therefore be `id + 1`.
+   * Starts at the maximum value so that the first expected ID is `0`.
+   *
+   */
+  uint64_t id = -1;
+
+  /**
+   * @brief Check if the buffer is full
+   *
+   * Must be called with `mutex` held
+   *
+   * @return `true` If no more elements can be pushed
+   */
+  bool full(void) { return count == queue.size(); }
+
+  /**
+   * @brief Check if `frame_id` is the next element to be pushed
+   *
+   * Must be called with `mutex` held
+   *
+   * @param frame_id ID of the element a producer wants to push
+   */
+  bool is_next(uint64_t frame_id) { return id + 1 == frame_id; }
+
+  /**
+   * @brief Get the condition variable a producer of `frame_id` waits on
+   *
+   * @param frame_id ID of the element a producer wants to push
+   */
+  std::condition_variable& turn_for(uint64_t frame_id) {
+    return turn.at(frame_id % turn.size());
+  }
+
+  /**
+   * @brief Insert `frame` at the back of the buffer and wake the consumer and
+   * the producer of the following element
+   *
+   * Must be called with `mutex` held, and only if `frame` is next and the
+   * buffer is not full
+   *
+   * @param frame Frame to be inserted
+   */
+  void insert(T frame) {
+    queue.at(back_index) = std::move(frame);
+    back_index = (back_index + 1) % queue.size();
+    count++;
+    id++;
+
+    not_empty.notify_one();
+    turn_for(id + 1).notify_all();
+  }
+
+ public:
+  /**
+   * @brief Construct a new `LockBuffer` object
+   *
+   * @param max_size Maximum desired useable size of underlying memory
+   */
+  explicit LockBuffer(size_t max_size) : queue(max_size), turn(max_size) {}
+
+  /**
+   * @brief Push a frame to the queue
+   *
+   * This blocks if the frame's ID is not the next in the series, until the
+   * missing frame has been pushed by another thread. Also blocks if the maximum
+   * size is reached, until elements are popped.
+   *
+   * @param frame Frame to be pushed to the queue
+   */
+  void push(T frame) {
+    std::unique_lock<std::mutex> lock(mutex);
+    turn_for(frame.id).wait(lock, [this, &frame] {
+      return stopped || (is_next(frame.id) && !full());
+    });
+    if (stopped) {
+      return;
+    }
+    insert(std::move(frame));
+  }
+
+  /**
+   * @brief Push a frame to the queue (doesn't block if queue is full)
+   *
+   * This blocks if the frame's ID is not the next in the series, until the
+   * missing frame has been pushed by another thread. It returns if the queue is
+   * full.
+   *
+   * @param frame Frame to be pushed to the queue
+   * @return `true` If pushing was successful
+   * @return `false` If the frame was not pushed, i.e., the queue was full; or
+   * the pipeline is halting
+   */
+  bool try_push(T frame) {
+    std::unique_lock<std::mutex> lock(mutex);
+    turn_for(frame.id).wait(lock, [this, &frame] {
+      return stopped || full() || is_next(frame.id);
+    });
+    if (stopped || full()) {
+      return false;
+    }
+    insert(std::move(frame));
+    return true;
+  }
+
+  /**
+   * @brief Pop the oldest element in the queue and return it
+   *
+   * Blocks until an element is available or the buffer is stopped.
+   *
+   * @return `Buffer::PopResult<T>` Oldest frame on the queue. Note: the
+   * `valid` flag of the result must be checked before use.
+   */
+  Buffer::PopResult<T> pop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    not_empty.wait(lock, [this] { return stopped || count != 0; });
+    if (stopped) {
+      return Buffer::PopResult<T>{T{}, false};
+    }
+
+    bool was_full = full();
+    Buffer::PopResult<T> front =
+        Buffer::PopResult<T>{std::move(queue.at(front_index)), true};
+    front_index = (front_index + 1) % queue.size();
+    count--;
+
+    if (was_full) {
+      // The producer of the next element may be waiting for space
+      turn_for(id + 1).notify_all();
+    }
+    return front;
+  }
+
+  /**
+   * @brief Stop the buffer and release all blocked threads
+   *
+   * Any thread blocked in `push()`, `try_push()` or `pop()` returns
+   * immediately; `pop()` then yields an invalid `PopResult`.
+   *
+   */
+  void stop(void) {
+    std::unique_lock<std::mutex> lock(mutex);
+    stopped = true;
+    not_empty.notify_all();
+    for (auto& cv : turn) {
+      cv.notify_all();
+    }
+  }
+};
+
+#endif  // BENCHMARK_LOCK_BUFFER_H_
@@ -0,0 +1,874 @@
+/**
+ * @file buffer.h
+ * @brief Synchronising buffers used to pass frames between pipeline stages
+ *
+ * @copyright Copyright (C) 2021  Miklas Riechmann
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef SRC_BUFFER_H_
+#define SRC_BUFFER_H_
+
+#include <stdint.h>
+
+#include <atomic>
+#include <chrono>              //NOLINT [build/c++11]
+#include <condition_variable>  //NOLINT [build/c++11]
+#include <memory>
+#include <mutex>   //NOLINT [build/c++11]
+#include <thread>  //NOLINT [build/c++11]
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Number of times a thread re-checks a lock-free condition before it is
+ * parked
+ *
+ */
+#define RING_SPIN_LIMIT 64
+
+/**
+ * @brief A synchronising buffer and results structure
+ *
+ */
+namespace Buffer {
+
+/**
+ * @brief Result when calling `SequencedRing::pop()`
+ *
+ * The structure has a field to indicate the validity of the result. It is
+ * possible for the buffer to return a result when the owning pipeline is shut
+ * down. In this situation the result could be invalid as the call to `pop()`
+ * may be blocking until data is available. In this situation a `valid` flag of
+ * `false` means the `value` field should not be used. A `valid` flag of `true`
+ * means the `value` is useable from the buffer's perspective.
+ *
+ * @tparam T Type of elements on the buffer
+ */
+template <typename T>
+struct PopResult {
+  T value;     ///< Actual popped result
+  bool valid;  ///< Indicates validity of the result
+};
+
+/**
+ * @brief Lets threads park until a lock-free condition becomes true
+ *
+ * Waiters first re-check their condition a few times before sleeping on a
+ * condition variable. Notifiers only take the mutex if somebody is actually
+ * asleep, so the uncontended path does not lock.
+ *
+ */
+class EventCount {
+ private:
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::atomic<size_t> waiters{0};  ///< Number of threads about to sleep
+
+ public:
+  /**
+   * @brief Block until `condition()` returns `true`
+   *
+   * @param condition Callable that is evaluated without holding any locks
+   */
+  template <typename Condition>
+  void wait(Condition condition) {
+    for (int i = 0; i < RING_SPIN_LIMIT; i++) {
+      if (condition()) {
+        return;
+      }
+      std::this_thread::yield();
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    waiters++;
+    cv.wait(lock, condition);
+    waiters--;
+  }
+
+  /**
+   * @brief Block until `condition()` returns `true` or `deadline` passes
+   *
+   * @param condition Callable that is evaluated without holding any locks
+   * @param deadline Time after which to give up waiting
+   * @return `bool` The final value of `condition()`
+   */
+  template <typename Condition>
+  bool wait_until(Condition condition,
+                  std::chrono::steady_clock::time_point deadline) {
+    for (int i = 0; i < RING_SPIN_LIMIT; i++) {
+      if (condition()) {
+        return true;
+      }
+      std::this_thread::yield();
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    waiters++;
+    bool result = cv.wait_until(lock, deadline, condition);
+    waiters--;
+    return result;
+  }
+
+  /**
+   * @brief Wake all parked threads so they can re-check their condition
+   *
+   * Must be called after the state the waiters depend on has been updated
+   *
+   */
+  void notify(void) {
+    if (waiters.load() != 0) {
+      std::unique_lock<std::mutex> lock(mutex);
+      cv.notify_all();
+    }
+  }
+};
+
+/**
+ * @brief Limits on how long the consumer of a `SequencedRing` waits for a
+ * missing element before declaring it lost
+ *
+ * Waiting only starts once there is evidence of a gap, i.e., once an element
+ * with a higher sequence number has been pushed. Either limit can be disabled
+ * by setting it to zero.
+ *
+ */
+struct ReorderWindow {
+  /**
+   * @brief Declare the missing element lost as soon as an element this many
+   * sequence numbers after it has been pushed
+   *
+   * Only a guess: a slow producer can still be working on the missing element
+   * when later ones arrive, in which case it is discarded as late when it
+   * does. Producers that know they will never push an element should call
+   * `SequencedRing::abandon()` instead. Values greater than or equal to the
+   * ring's capacity can never trigger, as producers cannot get that far ahead
+   * of the consumer.
+   *
+   */
+  uint64_t max_frames;
+
+  /**
+   * @brief Declare the missing element lost once a later element has been
+   * waiting for this many milliseconds
+   *
+   */
+  size_t timeout_ms;
+};
+
+/**
+ * @brief What a `SequencedRing` does with an element whose slot is still in
+ * use, i.e., when the consumer is a whole lap behind the producer
+ *
+ */
+enum Policy {
+  /**
+   * @brief Wait for the consumer to catch up. Nothing is ever dropped, which
+   * suits recording and batch analysis.
+   *
+   */
+  Block,
+
+  /**
+   * @brief Discard the element being pushed
+   *
+   */
+  DropNewest,
+
+  /**
+   * @brief Discard the element a lap behind in the slot to make room
+   *
+   */
+  DropOldest,
+
+  /**
+   * @brief As `DropOldest`, and additionally the consumer skips straight to
+   * the newest element that is ready, so it always works on the freshest
+   * data. Suits live display.
+   *
+   */
+  KeepLatest
+};
+
+/**
+ * @brief Counters describing what happened to elements passing through a
+ * `SequencedRing`
+ *
+ */
+struct Stats {
+  uint64_t popped;     ///< Elements handed to the consumer
+  /**
+   * @brief Sequence numbers skipped as their element never arrived, whether
+   * by the `ReorderWindow`, `SequencedRing::abandon()` or being evicted by
+   * the `Policy` before arriving
+   *
+   */
+  uint64_t lost;
+  uint64_t late;       ///< Elements pushed after being declared lost
+  uint64_t dropped;    ///< Elements discarded by the `Policy`
+  uint64_t occupancy;  ///< Elements currently stored and waiting to be popped
+  uint64_t producer_waits;  ///< Times a producer blocked as its slot was used
+  uint64_t consumer_waits;  ///< Times the consumer blocked for an element
+};
+
+/**
+ * @brief A lock-free multi-producer, single-consumer ring ordered by sequence
+ * number
+ *
+ * Elements are popped in the order of their `id` field.
+ * Instead of waiting for its turn to append to a queue, each producer writes
+ * straight into its own slot, `sequence % capacity`, and the consumer reads the
+ * slots in sequence order. Producers therefore never wait for each other. If a
+ * producer's slot still holds an element one lap behind that the consumer has
+ * not popped yet, the `Policy` decides whether the producer waits or which of
+ * the two elements is dropped.
+ *
+ * If an element will never arrive, e.g., because processing it failed, its
+ * producer calls `abandon()` so the consumer moves straight on to the elements
+ * behind it. Otherwise the `ReorderWindow` decides when the consumer gives up
+ * on a missing element. A producer that eventually does push such an element
+ * has it discarded.
+ *
+ * Every slot carries a stamp of `sequence * 4 + state` that encodes which
+ * sequence number the slot is currently for, and its state:
+ * - `Free` - waiting for the element with this sequence number
+ * - `Writing` - a producer is storing the element with this sequence number
+ * - `Ready` - holds the element with this sequence number
+ * - `Reading` - the consumer is taking the element with this sequence number
+ *
+ * If the consumer finds its slot stamped with a later sequence number, the
+ * element it was waiting for has been dropped and it moves on.
+ *
+ * Threads only block (see `Buffer::EventCount`) when there is nothing to pop,
+ * or a producer using `Policy::Block` is a whole lap ahead of the consumer.
+ *
+ * @tparam T The type for elements in the ring. This must provide an `id`
+ * field that is a `uint64_t`, starting from zero.
+ */
+template <typename T>
+class SequencedRing {
+ private:
+  enum State : uint64_t { Free = 0, Writing = 1, Ready = 2, Reading = 3 };
+
+  /**
+   * @brief Storage for a single element
+   *
+   */
+  struct Slot {
+    std::atomic<uint64_t> stamp;  ///< State of the slot, see class description
+    T value;                      ///< Element stored in the slot
+
+    /**
+     * @brief One more than the sequence number of an element dropped by
+     * `Policy::DropNewest`, or abandoned, that would have gone into this slot
+     *
+     * Lets the consumer skip the element without waiting for the
+     * `ReorderWindow`
+     *
+     */
+    std::atomic<uint64_t> dropped;
+  };
+
+  static uint64_t stamp_of(uint64_t sequence, State state) {
+    return sequence * 4 + state;
+  }
+  static uint64_t sequence_of(uint64_t stamp) { return stamp / 4; }
+  static State state_of(uint64_t stamp) { return State(stamp % 4); }
+
+  size_t capacity;                ///< Number of slots
+  std::unique_ptr<Slot[]> slots;  ///< Underlying storage
+  Policy policy;                  ///< What to do when a slot is in use
+  ReorderWindow window;           ///< When to give up on missing elements
+
+  /**
+   * @brief Sequence number of the next element to be popped
+   *
+   * Only accessed by the consumer
+   *
+   */
+  uint64_t head = 0;
+
+  /**
+   * @brief Highest sequence number pushed so far
+   *
+   * Used by the consumer to detect that the element it is waiting for is
+   * missing
+   *
+   */
+  std::atomic<uint64_t> newest{0};
+
+  std::atomic<uint64_t> popped{0};          ///< See `Stats::popped`
+  std::atomic<uint64_t> lost{0};            ///< See `Stats::lost`
+  std::atomic<uint64_t> late{0};            ///< See `Stats::late`
+  std::atomic<uint64_t> dropped{0};         ///< See `Stats::dropped`
+  std::atomic<uint64_t> occupancy{0};       ///< See `Stats::occupancy`
+  std::atomic<uint64_t> producer_waits{0};  ///< See `Stats::producer_waits`
+  std::atomic<uint64_t> consumer_waits{0};  ///< See `Stats::consumer_waits`
+
+  std::atomic<bool> stopped{false};  ///< Set by `stop()`
+
+  EventCount consumer;   ///< Where the consumer parks when the ring is empty
+  EventCount producers;  ///< Where producers park when their slot is in use
+
+  Slot& slot_for(uint64_t sequence) { return slots[sequence % capacity]; }
+
+  /**
+   * @brief Check if the element following `sequence` is far enough ahead to
+   * declare `sequence` lost without waiting for the timeout
+   *
+   */
+  bool beyond_window(uint64_t sequence) {
+    return window.max_frames != 0 &&
+           newest.load() >= sequence + window.max_frames;
+  }
+
+  /**
+   * @brief Check if the consumer can make progress on `sequence` without
+   * waiting
+   *
+   * @param sequence Sequence number at the head of the ring
+   * @param gap Whether a later element has already been seen
+   */
+  bool actionable(uint64_t sequence, bool gap) {
+    Slot& slot = slot_for(sequence);
+    uint64_t stamp = slot.stamp.load();
+    return stopped || sequence_of(stamp) > sequence ||
+           stamp == stamp_of(sequence, Ready) ||
+           slot.dropped.load() == sequence + 1 ||
+           (!gap && newest.load() > sequence) || beyond_window(sequence);
+  }
+
+  /**
+   * @brief Try to take the element with sequence number `sequence` out of its
+   * slot
+   *
+   * @param sequence Sequence number at the head of the ring
+   * @param value Where to move the element to
+   * @return `true` If the element was taken and `head` advanced
+   */
+  bool take(uint64_t sequence, T* value) {
+    Slot& slot = slot_for(sequence);
+    uint64_t expected = stamp_of(sequence, Ready);
+    if (!slot.stamp.compare_exchange_strong(expected,
+                                            stamp_of(sequence, Reading))) {
+      return false;
+    }
+    *value = std::move(slot.value);
+    slot.stamp = stamp_of(sequence + capacity, Free);
+    head = sequence + 1;
+    occupancy--;
+    producers.notify();
+    return true;
+  }
+
+  /**
+   * @brief Move the head past `sequence` without popping it
+   *
+   * @param sequence Sequence number at the head of the ring
+   * @return `true` If the slot was free and has been released to the next lap
+   */
+  bool skip(uint64_t sequence) {
+    uint64_t expected = stamp_of(sequence, Free);
+    if (!slot_for(sequence).stamp.compare_exchange_strong(
+            expected, stamp_of(sequence + capacity, Free))) {
+      return false;
+    }
+    head = sequence + 1;
+    producers.notify();
+    return true;
+  }
+
+  /**
+   * @brief Claim `slot` for `sequence` when it is still in use by an earlier
+   * lap, according to `policy`
+   *
+   * @param slot Slot for `sequence`
+   * @param sequence Sequence number of the element being pushed
+   * @param stamp Stamp that was last read from `slot`
+   * @return `true` If `slot` has been claimed, i.e., it is now `Writing`
+   */
+  bool claim_used(Slot& slot, uint64_t sequence, uint64_t stamp) {
+    switch (policy) {
+      case Block:
+        producer_waits++;
+        producers.wait([this, &slot, sequence] {
+          return stopped || sequence_of(slot.stamp.load()) >= sequence;
+        });
+        return false;
+
+      case DropNewest:
+        slot.dropped = sequence + 1;
+        dropped++;
+        consumer.notify();
+        return false;
+
+      case DropOldest:
+      case KeepLatest:
+        if (state_of(stamp) == Ready || state_of(stamp) == Free) {
+          // Evict the stored element, or the missing one it was waiting for
+          if (slot.stamp.compare_exchange_strong(
+                  stamp, stamp_of(sequence, Writing))) {
+            if (state_of(stamp) == Free) {
+              // The evicted element never arrived, so nothing was dropped
+              lost++;
+              occupancy++;
+            } else {
+              dropped++;
+            }
+            consumer.notify();
+            return true;
+          }
+        } else {
+          // Only briefly `Writing` or `Reading`
+          std::this_thread::yield();
+        }
+        return false;
+    }
+    return false;
+  }
+
+ public:
+  /**
+   * @brief Construct a new `SequencedRing` object
+   *
+   * @param capacity Number of slots; this bounds how far ahead of the consumer
+   * a producer can get
+   * @param window When to give up on a missing element. By default the
+   * consumer waits forever.
+   * @param policy What to do when the consumer is a whole lap behind
+   */
+  explicit SequencedRing(size_t capacity,
+                         ReorderWindow window = ReorderWindow{0, 0},
+                         Policy policy = Block)
+      : capacity(capacity),
+        slots(new Slot[capacity]),
+        policy(policy),
+        window(window) {
+    for (size_t i = 0; i < capacity; i++) {
+      slots[i].stamp = stamp_of(i, Free);
+      slots[i].dropped = 0;
+    }
+  }
+
+  /**
+   * @brief Push an element into its slot
+   *
+   * If the slot still holds the element from the previous lap, i.e., the
+   * element with sequence number `capacity` lower has not been popped yet,
+   * the `Policy` applies. If the consumer has already given up on this
+   * element it is discarded.
+   *
+   * @param element Element to be pushed
+   */
+  void push(T element) {
+    uint64_t sequence = element.id;
+    Slot& slot = slot_for(sequence);
+
+    while (true) {
+      if (stopped) {
+        return;
+      }
+
+      uint64_t stamp = slot.stamp.load();
+      if (sequence_of(stamp) > sequence) {
+        // The consumer gave up on this element or a later one replaced it
+        late++;
+        return;
+      }
+
+      if (sequence_of(stamp) == sequence) {
+        uint64_t expected = stamp_of(sequence, Free);
+        if (slot.stamp.compare_exchange_strong(expected,
+                                               stamp_of(sequence, Writing))) {
+          occupancy++;
+          break;
+        }
+        continue;
+      }
+
+      if (claim_used(slot, sequence, stamp)) {
+        break;
+      }
+      if (policy == DropNewest) {
+        return;
+      }
+    }
+
+    slot.value = std::move(element);
+    slot.stamp = stamp_of(sequence, Ready);
+
+    uint64_t previous = newest.load();
+    while (previous < sequence &&
+           !newest.compare_exchange_weak(previous, sequence)) {
+    }
+    consumer.notify();
+  }
+
+  /**
+   * @brief Give up on an element that will never be pushed, e.g., because
+   * processing it failed
+   *
+   * The consumer skips it as soon as it gets to it, instead of waiting for the
+   * `ReorderWindow`. Must not be called for an element that has been or will
+   * be pushed.
+   *
+   * @param sequence Sequence number of the element
+   */
+  void abandon(uint64_t sequence) {
+    Slot& slot = slot_for(sequence);
+    uint64_t stamp = slot.stamp.load();
+    while (sequence_of(stamp) <= sequence) {
+      if (stamp == stamp_of(sequence, Free)) {
+        // Release the slot to the next lap, which the consumer skips
+        if (slot.stamp.compare_exchange_weak(
+                stamp, stamp_of(sequence + capacity, Free))) {
+          lost++;
+          break;
+        }
+        continue;
+      }
+
+      // Still used by the previous lap, so leave a mark to skip it by
+      slot.dropped = sequence + 1;
+      lost++;
+      break;
+    }
+    consumer.notify();
+    producers.notify();
+  }
+
+  /**
+   * @brief Pop the next element in sequence order
+   *
+   * Blocks until the element is available, it is declared lost or dropped (in
+   * which case the following element is waited for instead), or the ring is
+   * stopped. With `Policy::KeepLatest`, any further elements that are ready
+   * are popped as well and only the newest one is returned.
+   *
+   * @return `PopResult<T>` Next element. Note: the `valid` flag of the result
+   * must be checked before use.
+   */
+  PopResult<T> pop() {
+    bool gap = false;  ///< Whether a later element has been seen
+    std::chrono::steady_clock::time_point gap_start;
+
+    while (true) {
+      uint64_t sequence = head;
+      Slot& slot = slot_for(sequence);
+
+      if (!actionable(sequence, gap)) {
+        consumer_waits++;
+        auto ready = [this, sequence, &gap] {
+          return actionable(sequence, gap);
+        };
+        if (gap && window.timeout_ms != 0) {
+          consumer.wait_until(
+              ready, gap_start + std::chrono::milliseconds(window.timeout_ms));
+        } else {
+          consumer.wait(ready);
+        }
+      }
+
+      if (stopped) {
+        return PopResult<T>{T{}, false};
+      }
+
+      uint64_t stamp = slot.stamp.load();
+      if (sequence_of(stamp) > sequence) {
+        // Dropped in favour of an element a lap (or more) ahead
+        head = sequence + 1;
+        continue;
+      }
+
+      PopResult<T> front = PopResult<T>{T{}, false};
+      if (take(sequence, &front.value)) {
+        front.valid = true;
+        while (policy == KeepLatest && take(head, &front.value)) {
+          dropped++;
+        }
+        popped++;
+        return front;
+      }
+
+      if (slot.dropped.load() == sequence + 1) {
+        skip(sequence);
+        continue;
+      }
+
+      if (!gap && newest.load() > sequence) {
+        // Start timing from the first sign of the element being missing
+        gap = true;
+        gap_start = std::chrono::steady_clock::now();
+      }
+
+      bool timed_out =
+          gap && window.timeout_ms != 0 &&
+          std::chrono::steady_clock::now() >=
+              gap_start + std::chrono::milliseconds(window.timeout_ms);
+      if ((timed_out || beyond_window(sequence)) && skip(sequence)) {
+        // Only fails if the producer turned up after all
+        lost++;
+      }
+    }
+  }
+
+  /**
+   * @brief Get the counters for this ring
+   *
+   * @return `Stats`
+   */
+  Stats stats(void) {
+    return Stats{popped.load(),         lost.load(),
+                 late.load(),           dropped.load(),
+                 occupancy.load(),      producer_waits.load(),
+                 consumer_waits.load()};
+  }
+
+  /**
+   * @brief Stop the ring and release all blocked threads
+   *
+   * Any thread blocked in `push()` or `pop()` returns immediately; `pop()`
+   * then yields an invalid `PopResult`.
+   *
+   */
+  void stop(void) {
+    stopped = true;
+    consumer.notify();
+    producers.notify();
+  }
+};
+/**
+ * @brief Holds the most recently published value, for one writer and several
+ * readers that only care about the newest value
+ *
+ * The writer never blocks and never waits for readers, and readers never wait
+ * for the writer. There are `readers + 2` slots: the one holding the latest
+ * value, one for each reader that may be copying out of an older slot, and at
+ * least one more that is neither, which the writer fills next before making
+ * it the latest.
+ *
+ * A reader pins the latest slot by incrementing its pin count, then checks it
+ * is still the latest. The writer only ever writes into a slot that is not
+ * the latest and not pinned. A read only has to retry if the writer published
+ * in the few instructions between the reader loading and pinning the slot.
+ * Once a value is replaced, it is released straight away unless it is still
+ * being read.
+ *
+ * @tparam T The type of the value. Copied out on every `read()`
+ */
+template <typename T>
+class LatestSlot {
+ private:
+  size_t num_slots;                             ///< `readers + 2`
+  std::unique_ptr<T[]> slots;                   ///< Underlying storage
+  std::unique_ptr<std::atomic<size_t>[]> pins;  ///< Readers using each slot
+  std::atomic<size_t> latest{0};                ///< Slot with the newest value
+
+ public:
+  /**
+   * @brief Construct a new Latest Slot object
+   *
+   * Until the first `publish()`, readers get a default constructed `T`.
+   *
+   * @param readers Maximum number of threads that may call `read()` at once
+   */
+  explicit LatestSlot(size_t readers)
+      : num_slots(readers + 2),
+        slots(new T[readers + 2]()),
+        pins(new std::atomic<size_t>[readers + 2]) {
+    for (size_t i = 0; i < num_slots; i++) {
+      pins[i] = 0;
+    }
+  }
+
+  /**
+   * @brief Make `value` the latest value
+   *
+   * Must only be called by one thread at a time.
+   *
+   */
+  void publish(T value) {
+    size_t current = latest.load();
+    size_t next = current;
+    do {
+      next = (next + 1) % num_slots;
+    } while (next == current || pins[next].load() != 0);
+
+    slots[next] = std::move(value);
+    latest.store(next);
+
+    // Release the previous value rather than keeping it alive until its slot
+    // is reused, e.g. so camera buffers go back to the driver sooner
+    if (pins[current].load() == 0) {
+      slots[current] = T();
+    }
+  }
+
+  /**
+   * @brief Get a copy of the latest value
+   *
+   * @return `T` The value passed to the most recent `publish()`
+   */
+  T read(void) {
+    size_t index;
+    while (true) {
+      index = latest.load();
+      pins[index]++;
+      if (latest.load() == index) {
+        break;
+      }
+      // Published to in the meantime, so the writer may already be reusing it
+      pins[index]--;
+    }
+    T value = slots[index];
+    pins[index]--;
+    return value;
+  }
+};
+
+/**
+ * @brief Usage of a `Pool`
+ *
+ */
+struct PoolStats {
+  size_t capacity;    ///< Number of objects in the pool
+  size_t in_use;      ///< Number of objects currently handed out
+  size_t high_water;  ///< Most objects ever handed out at once
+  uint64_t waits;     ///< Times `acquire()` waited for an object to be freed
+};
+
+/**
+ * @brief A fixed set of objects that are handed out and returned, so that
+ * they are only ever allocated once
+ *
+ * `acquire()` returns a `Pool::Handle`, which returns its object to the pool
+ * when it is destroyed, including when an exception unwinds past it. Objects
+ * are not reset in between, so any memory they hold on to is reused.
+ *
+ * The pool must outlive all handles to its objects.
+ *
+ * @tparam T The type of object. Must be default constructible
+ */
+template <typename T>
+class Pool {
+ private:
+  std::vector<std::unique_ptr<T>> objects;  ///< Owns every object
+  std::vector<T*> available;                ///< Objects not handed out
+
+  std::mutex mutex;  ///< Protects everything below and `available`
+  std::condition_variable cv;
+  size_t high_water = 0;
+  uint64_t waits = 0;
+
+  void release(T* object) {
+    std::unique_lock<std::mutex> lock(mutex);
+    available.push_back(object);
+    cv.notify_one();
+  }
+
+ public:
+  /**
+   * @brief Exclusive use of an object from a `Pool`
+   *
+   * Move-only, like `std::unique_ptr`.
+   *
+   */
+  class Handle {
+   private:
+    friend class Pool;
+    Pool* pool;
+    T* object;
+
+    Handle(Pool* pool, T* object) : pool(pool), object(object) {}
+
+   public:
+    Handle(Handle&& other) : pool(other.pool), object(other.object) {
+      other.object = nullptr;
+    }
+
+    Handle& operator=(Handle&& other) {
+      if (this != &other) {
+        if (object != nullptr) {
+          pool->release(object);
+        }
+        pool = other.pool;
+        object = other.object;
+        other.object = nullptr;
+      }
+      return *this;
+    }
+
+    Handle(const Handle&) = delete;
+    Handle& operator=(const Handle&) = delete;
+
+    ~Handle() {
+      if (object != nullptr) {
+        pool->release(object);
+      }
+    }
+
+    T& operator*(void) { return *object; }
+    T* operator->(void) { return object; }
+  };
+
+  /**
+   * @brief Construct a new Pool object, allocating all of its objects
+   *
+   * @param capacity Number of objects, e.g. the number of threads using them
+   */
+  explicit Pool(size_t capacity) {
+    for (size_t i = 0; i < capacity; i++) {
+      objects.push_back(std::unique_ptr<T>(new T()));
+      available.push_back(objects.back().get());
+    }
+  }
+
+  /**
+   * @brief Take an object out of the pool, waiting for one to be returned if
+   * they are all in use
+   *
+   * @return `Handle` Returns the object to the pool when destroyed
+   */
+  Handle acquire(void) {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (available.empty()) {
+      waits++;
+      cv.wait(lock, [this] { return !available.empty(); });
+    }
+    T* object = available.back();
+    available.pop_back();
+
+    size_t in_use = objects.size() - available.size();
+    if (in_use > high_water) {
+      high_water = in_use;
+    }
+    return Handle(this, object);
+  }
+
+  /**
+   * @brief Get the current usage of the pool
+   *
+   * @return `PoolStats`
+   */
+  PoolStats stats(void) {
+    std::unique_lock<std::mutex> lock(mutex);
+    return PoolStats{objects.size(), objects.size() - available.size(),
+                     high_water, waits};
+  }
+};
+}  // namespace Buffer
+
+#endif  // SRC_BUFFER_H_
@@ -0,0 +1,100 @@
+/**
+ * @copyright Copyright (C) 2021  Miklas Riechmann
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "frame_source.h"
+
+#include <stdexcept>
+#include <thread>  //NOLINT [build/c++11]
+
+#include "opencv2/imgcodecs.hpp"
+
+namespace FrameSource {
+
+Camera::Camera(int index) : cap(index) {
+  if (!cap.isOpened()) {
+    throw std::runtime_error("Cannot access camera");
+  }
+}
+
+bool Camera::grab(void) { return cap.grab(); }
+
+bool Camera::retrieve(cv::Mat* frame) { return cap.retrieve(*frame); }
+
+Synthetic::Synthetic(std::vector<cv::Mat> frames, size_t frame_delay_ms)
+    : frames(frames),
+      frame_delay(std::chrono::milliseconds(frame_delay_ms)),
+      next_frame_time(std::chrono::steady_clock::now()) {
+  if (this->frames.empty()) {
+    throw std::invalid_argument("frames must not be empty");
+  }
+}
+
+bool Synthetic::grab(void) {
+  if (frame_delay.count() > 0) {
+    std::this_thread::sleep_until(next_frame_time);
+    next_frame_time += frame_delay;
+
+    // Like a camera, do not try to catch up on frames that were not grabbed
+    auto now = std::chrono::steady_clock::now();
+    if (next_frame_time < now) {
+      next_frame_time = now;
+    }
+  }
+
+  grabbed = index;
+  index = (index + 1) % frames.size();
+  return true;
+}
+
+bool Synthetic::retrieve(cv::Mat* frame) {
+  *frame = frames.at(grabbed);
+  return true;
+}
+
+std::vector<cv::Mat> Synthetic::noise(cv::Size size, size_t count) {
+  std::vector<cv::Mat> frames;
+  for (size_t i = 0; i < count; i++) {
+    cv::Mat frame(size, CV_8UC3);
+    cv::randu(frame, cv::Scalar::all(0), cv::Scalar::all(256));
+    frames.push_back(frame);
+  }
+  return frames;
+}
+
+ImageSequence::ImageSequence(std::string pattern, size_t frame_delay_ms)
+    : Synthetic(load(pattern), frame_delay_ms) {}
+
+std::vector<cv::Mat> ImageSequence::load(std::string pattern) {
+  std::vector<cv::String> paths;
+  cv::glob(pattern, paths);
+
+  std::vector<cv::Mat> frames;
+  for (auto& path : paths) {
+    cv::Mat frame = cv::imread(path);
+    // Skip anything in the directory that is not an image
+    if (!frame.empty()) {
+      frames.push_back(frame);
+    }
+  }
+  if (frames.empty()) {
+    throw std::invalid_argument("No images match " + pattern);
+  }
+  return frames;
+}
+
+}  // namespace FrameSource
@@ -0,0 +1,220 @@
+/**
+ * @file frame_source.h
+ * @brief Sources of frames for the pipeline
+ *
+ * @copyright Copyright (C) 2021  Miklas Riechmann
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef SRC_FRAME_SOURCE_H_
+#define SRC_FRAME_SOURCE_H_
+
+#include <chrono>  //NOLINT [build/c++11]
+#include <string>
+#include <vector>
+
+#include "opencv2/core.hpp"
+#include "opencv2/videoio.hpp"
+
+/**
+ * @brief Sources of frames that the `Pipeline::FrameGenerator` reads from
+ *
+ * A source produces frames at its own rate, e.g. the rate of the camera. The
+ * `Pipeline::FrameGenerator` keeps reading from it so that it always holds the
+ * newest frame, and its timer decides which of these frames enter the
+ * pipeline.
+ *
+ */
+namespace FrameSource {
+
+/**
+ * @brief Layout of the pixels in a frame
+ *
+ */
+enum PixelFormat {
+  BGR,   ///< `CV_8UC3`, as used by OpenCV
+  RGB,   ///< `CV_8UC3`, as used by the model and Qt
+  YUYV,  ///< `CV_8UC2`, Y0 U Y1 V for every two pixels (4:2:2)
+  /**
+   * @brief `CV_8UC1` of 1.5 times the frame height: the Y plane followed by a
+   * plane of interleaved U V at half the width and height (4:2:0)
+   *
+   */
+  NV12,
+};
+
+/**
+ * @brief Interface for anything that can feed frames into the pipeline
+ *
+ */
+class FrameSource {
+ public:
+  virtual ~FrameSource() {}
+
+  /**
+   * @brief Get the pixel format of the frames this source produces
+   *
+   * Sources that can deliver frames in the camera's native format do so, so
+   * that frames are only converted once they have been resized.
+   *
+   */
+  virtual PixelFormat pixel_format(void) { return BGR; }
+
+  /**
+   * @brief Block until the next frame is available and take it from the
+   * source, without decoding it
+   *
+   * This is cheap compared to `retrieve()`, so a source can be kept up to date
+   * by grabbing every frame while only retrieving the ones that are used.
+   *
+   * @return `true` If a frame was grabbed
+   * @return `false` If no frame could be grabbed
+   */
+  virtual bool grab(void) = 0;
+
+  /**
+   * @brief Decode the frame taken by the last `grab()`
+   *
+   * @param frame Set to the frame
+   * @return `true` If a frame was retrieved
+   * @return `false` If no frame could be retrieved
+   */
+  virtual bool retrieve(cv::Mat* frame) = 0;
+
+  /**
+   * @brief Block until the next frame is available and read it
+   *
+   * @param frame Set to the next frame
+   * @return `true` If a frame was read
+   * @return `false` If no frame could be read
+   */
+  bool read(cv::Mat* frame) { return grab() && retrieve(frame); }
+};
+
+/**
+ * @brief Frames from a camera, as seen by OpenCV
+ *
+ */
+class Camera : public FrameSource {
+ private:
+  /**
+   * @brief Video stream handle
+   *
+   */
+  cv::VideoCapture cap;
+
+ public:
+  /**
+   * @brief Construct a new Camera object
+   *
+   * @param index Index of the camera to open
+   * @throw `std::runtime_error` if the camera cannot be accessed
+   */
+  explicit Camera(int index);
+
+  bool grab(void);
+  bool retrieve(cv::Mat* frame);
+};
+
+/**
+ * @brief Replays an in-memory set of frames in a loop at a fixed rate
+ *
+ * Frames are handed out without copying them, so they must not be modified by
+ * the caller.
+ *
+ */
+class Synthetic : public FrameSource {
+ private:
+  std::vector<cv::Mat> frames;
+
+  /**
+   * @brief Index of the frame to be grabbed next
+   *
+   */
+  size_t index = 0;
+
+  /**
+   * @brief Index of the frame taken by the last `grab()`
+   *
+   */
+  size_t grabbed = 0;
+
+  /**
+   * @brief Time between frames, zero to replay as fast as possible
+   *
+   */
+  std::chrono::steady_clock::duration frame_delay;
+
+  /**
+   * @brief Time at which the next frame is due
+   *
+   */
+  std::chrono::steady_clock::time_point next_frame_time;
+
+ public:
+  /**
+   * @brief Construct a new Synthetic object
+   *
+   * @param frames Frames to replay, in order
+   * @param frame_delay_ms Delay between two frames in ms. Zero replays frames
+   * as fast as they are read
+   * @throw `std::invalid_argument` if `frames` is empty
+   */
+  Synthetic(std::vector<cv::Mat> frames, size_t frame_delay_ms);
+
+  bool grab(void);
+  bool retrieve(cv::Mat* frame);
+
+  /**
+   * @brief Generate random frames
+   *
+   * Useful to load the pipeline when no real images are available. Random
+   * noise costs as much to process as any other image of the same size.
+   *
+   * @param size Size of each frame
+   * @param count Number of different frames to generate
+   * @return `std::vector<cv::Mat>` BGR frames of random noise
+   */
+  static std::vector<cv::Mat> noise(cv::Size size, size_t count);
+};
+
+/**
+ * @brief Replays a sequence of image files in a loop at a fixed rate
+ *
+ * All images are loaded upon construction, so that reading from disk does not
+ * affect the timing.
+ *
+ */
+class ImageSequence : public Synthetic {
+ public:
+  /**
+   * @brief Construct a new Image Sequence object
+   *
+   * @param pattern Directory containing the images, or a `cv::glob()` pattern
+   * matching them. Images are replayed in sorted order
+   * @param frame_delay_ms Delay between two frames in ms. Zero replays frames
+   * as fast as they are read
+   * @throw `std::invalid_argument` if no image matches `pattern`
+   */
+  ImageSequence(std::string pattern, size_t frame_delay_ms);
+
+ private:
+  static std::vector<cv::Mat> load(std::string pattern);
+};
+
+}  // namespace FrameSource
+
+#endif  // SRC_FRAME_SOURCE_H_
@@ -23,6 +23,7 @@
 
 #include "../intermediate_structures.h"
 #include "../posture_estimator.h"
+#include "../trace.h"
 
 #define LOGO_HEIGHT_MAX 100
 #define SLOUCH_SENSITIVITY_MAX 50
@@ -160,8 +161,9 @@ void GUI::MainWindow::createMainPage() {
   mainPageLayout->addWidget(mainPageButtonsBot, 2, 1);
 
   qRegisterMetaType<cv::Mat>("cv::Mat");
-  connect(this, SIGNAL(currentFrameSignal(cv::Mat)), this,
-          SLOT(updateVideoFrame(cv::Mat)));
+  qRegisterMetaType<uint64_t>("uint64_t");
+  connect(this, SIGNAL(currentFrameSignal(cv::Mat, uint64_t)), this,
+          SLOT(updateVideoFrame(cv::Mat, uint64_t)));
 }
 
 void GUI::MainWindow::createSettingsPage() {
@@ -355,11 +357,13 @@ void GUI::MainWindow::initalFrame() {
   mainPageLayout->addWidget(frame, 1, 0, 2, 1);
 }
 
-void GUI::MainWindow::emitNewFrame(cv::Mat currentFrame) {
-  emit currentFrameSignal(currentFrame);
+void GUI::MainWindow::emitNewFrame(cv::Mat currentFrame, uint64_t frameId) {
+  emit currentFrameSignal(currentFrame, frameId);
 }
 
-void GUI::MainWindow::updateVideoFrame(cv::Mat currentFrame) {
+void GUI::MainWindow::updateVideoFrame(cv::Mat currentFrame,
+                                       uint64_t frameId) {
+  TRACE_SPAN("GUI paint", frameId);
   QImage imgIn = QImage((uchar *)  // NOLINT [readability/casting]
                         currentFrame.data,
                         currentFrame.cols, currentFrame.rows, currentFrame.step,
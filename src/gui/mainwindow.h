@@ -147,8 +147,9 @@ class MainWindow : public QMainWindow {
    * @brief Refresh the video feed to the most recent frame
    *
    * @param currentFrame a `cv::Mat` object
+   * @param frameId ID of the frame in the pipeline, used for tracing
    */
-  void emitNewFrame(cv::Mat currentFrame);
+  void emitNewFrame(cv::Mat currentFrame, uint64_t frameId);
 
   /**
    * @brief Creates the main page within the application
@@ -211,7 +212,7 @@ class MainWindow : public QMainWindow {
    * @brief update the video ouput once a new frame has been captured
    *
    */
-  void updateVideoFrame(cv::Mat currentFrame);
+  void updateVideoFrame(cv::Mat currentFrame, uint64_t frameId);
 
   /**
    * @brief update the posture notification using the posture status "good"
@@ -244,8 +245,9 @@ class MainWindow : public QMainWindow {
    * @brief emit the newly captured frame
    *
    * @param currentFrame cv::Mat object containing the current captured frame
+   * @param frameId ID of the frame in the pipeline, used for tracing
    */
-  void currentFrameSignal(cv::Mat currentFrame);
+  void currentFrameSignal(cv::Mat currentFrame, uint64_t frameId);
 
   /**
    * @brief emit the newly captured good posture value
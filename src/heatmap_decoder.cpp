@@ -0,0 +1,711 @@
+/**
+ * @copyright Copyright (C) 2021  Miklas Riechmann
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "heatmap_decoder.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "metrics.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define ARGMAX_X86
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#define ARGMAX_NEON
+#include <arm_neon.h>
+#endif
+
+static_assert(HEATMAP_CHANNELS == 16,
+              "Vectorised kernels expect 16 channels per pixel");
+
+namespace Inference {
+
+static void argmax_scalar(const float* heatmap, size_t num_pixels,
+                          float* max, uint32_t* index) {
+  for (int c = 0; c < HEATMAP_CHANNELS; c++) {
+    max[c] = 0;
+    index[c] = 0;
+  }
+  for (size_t p = 0; p < num_pixels; p++) {
+    const float* values = &heatmap[p * HEATMAP_CHANNELS];
+    for (int c = 0; c < HEATMAP_CHANNELS; c++) {
+      if (values[c] > max[c]) {
+        max[c] = values[c];
+        index[c] = p;
+      }
+    }
+  }
+}
+
+#ifdef ARGMAX_X86
+/**
+ * @brief Keep the values, and the pixel they are from, that are greater than
+ * the best so far
+ *
+ */
+__attribute__((target("sse4.1"))) static inline void argmax_step_sse41(
+    __m128 values, __m128i pixel, __m128* best, __m128i* best_index) {
+  __m128 greater = _mm_cmpgt_ps(values, *best);
+  // Returns `*best` for NaN, like the comparison
+  *best = _mm_max_ps(values, *best);
+  *best_index = _mm_castps_si128(_mm_blendv_ps(
+      _mm_castsi128_ps(*best_index), _mm_castsi128_ps(pixel), greater));
+}
+
+__attribute__((target("sse4.1"))) static void argmax_sse41(
+    const float* heatmap, size_t num_pixels, float* max, uint32_t* index) {
+  __m128 best[4] = {_mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps(),
+                    _mm_setzero_ps()};
+  __m128i best_index[4] = {_mm_setzero_si128(), _mm_setzero_si128(),
+                           _mm_setzero_si128(), _mm_setzero_si128()};
+  __m128i pixel = _mm_setzero_si128();
+  const __m128i one = _mm_set1_epi32(1);
+
+  for (size_t p = 0; p < num_pixels; p++) {
+    const float* values = &heatmap[p * HEATMAP_CHANNELS];
+    argmax_step_sse41(_mm_loadu_ps(&values[0]), pixel, &best[0],
+                      &best_index[0]);
+    argmax_step_sse41(_mm_loadu_ps(&values[4]), pixel, &best[1],
+                      &best_index[1]);
+    argmax_step_sse41(_mm_loadu_ps(&values[8]), pixel, &best[2],
+                      &best_index[2]);
+    argmax_step_sse41(_mm_loadu_ps(&values[12]), pixel, &best[3],
+                      &best_index[3]);
+    pixel = _mm_add_epi32(pixel, one);
+  }
+
+  for (int k = 0; k < 4; k++) {
+    _mm_storeu_ps(&max[k * 4], best[k]);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(&index[k * 4]),
+                     best_index[k]);
+  }
+}
+
+/**
+ * @brief As `argmax_step_sse41()`, for 8 channels
+ *
+ */
+__attribute__((target("avx2"))) static inline void argmax_step_avx2(
+    __m256 values, __m256i pixel, __m256* best, __m256i* best_index) {
+  __m256 greater = _mm256_cmp_ps(values, *best, _CMP_GT_OQ);
+  *best = _mm256_max_ps(values, *best);
+  *best_index = _mm256_castps_si256(_mm256_blendv_ps(
+      _mm256_castsi256_ps(*best_index), _mm256_castsi256_ps(pixel), greater));
+}
+
+__attribute__((target("avx2"))) static void argmax_avx2(const float* heatmap,
+                                                        size_t num_pixels,
+                                                        float* max,
+                                                        uint32_t* index) {
+  __m256 best[2] = {_mm256_setzero_ps(), _mm256_setzero_ps()};
+  __m256i best_index[2] = {_mm256_setzero_si256(), _mm256_setzero_si256()};
+  __m256i pixel = _mm256_setzero_si256();
+  const __m256i one = _mm256_set1_epi32(1);
+
+  for (size_t p = 0; p < num_pixels; p++) {
+    const float* values = &heatmap[p * HEATMAP_CHANNELS];
+    argmax_step_avx2(_mm256_loadu_ps(&values[0]), pixel, &best[0],
+                     &best_index[0]);
+    argmax_step_avx2(_mm256_loadu_ps(&values[8]), pixel, &best[1],
+                     &best_index[1]);
+    pixel = _mm256_add_epi32(pixel, one);
+  }
+
+  for (int k = 0; k < 2; k++) {
+    _mm256_storeu_ps(&max[k * 8], best[k]);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(&index[k * 8]),
+                        best_index[k]);
+  }
+}
+#endif
+
+#ifdef ARGMAX_NEON
+/**
+ * @brief Keep the values, and the pixel they are from, that are greater than
+ * the best so far
+ *
+ */
+static inline void argmax_step_neon(float32x4_t values, uint32x4_t pixel,
+                                    float32x4_t* best,
+                                    uint32x4_t* best_index) {
+  uint32x4_t greater = vcgtq_f32(values, *best);
+  *best = vbslq_f32(greater, values, *best);
+  *best_index = vbslq_u32(greater, pixel, *best_index);
+}
+
+static void argmax_neon(const float* heatmap, size_t num_pixels, float* max,
+                        uint32_t* index) {
+  float32x4_t best[4] = {vdupq_n_f32(0), vdupq_n_f32(0), vdupq_n_f32(0),
+                         vdupq_n_f32(0)};
+  uint32x4_t best_index[4] = {vdupq_n_u32(0), vdupq_n_u32(0), vdupq_n_u32(0),
+                              vdupq_n_u32(0)};
+  uint32x4_t pixel = vdupq_n_u32(0);
+  const uint32x4_t one = vdupq_n_u32(1);
+
+  for (size_t p = 0; p < num_pixels; p++) {
+    const float* values = &heatmap[p * HEATMAP_CHANNELS];
+    argmax_step_neon(vld1q_f32(&values[0]), pixel, &best[0], &best_index[0]);
+    argmax_step_neon(vld1q_f32(&values[4]), pixel, &best[1], &best_index[1]);
+    argmax_step_neon(vld1q_f32(&values[8]), pixel, &best[2], &best_index[2]);
+    argmax_step_neon(vld1q_f32(&values[12]), pixel, &best[3], &best_index[3]);
+    pixel = vaddq_u32(pixel, one);
+  }
+
+  for (int k = 0; k < 4; k++) {
+    vst1q_f32(&max[k * 4], best[k]);
+    vst1q_u32(&index[k * 4], best_index[k]);
+  }
+}
+#endif
+
+/*
+ * The quantised kernels compare `int8_t`s, so `uint8_t` heatmaps have their
+ * top bit flipped by `bias`, which maps [0..255] onto [-128..127] in order.
+ * Values that are not above `floor` are ignored.
+ */
+
+static void argmax_quantised_scalar(const uint8_t* heatmap, size_t num_pixels,
+                                    uint8_t bias, int8_t floor, int8_t* max,
+                                    uint32_t* index) {
+  for (int c = 0; c < HEATMAP_CHANNELS; c++) {
+    max[c] = floor;
+    index[c] = 0;
+  }
+  for (size_t p = 0; p < num_pixels; p++) {
+    const uint8_t* values = &heatmap[p * HEATMAP_CHANNELS];
+    for (int c = 0; c < HEATMAP_CHANNELS; c++) {
+      int8_t value = static_cast<int8_t>(values[c] ^ bias);
+      if (value > max[c]) {
+        max[c] = value;
+        index[c] = p;
+      }
+    }
+  }
+}
+
+#ifdef ARGMAX_X86
+/*
+ * A pixel fits in a single register, so the vectorised kernels first find the
+ * highest value of each channel with one instruction per pixel, and then the
+ * first pixel each is found at, stopping once all have been found.
+ */
+
+/**
+ * @brief Load pixel `p` of a quantised heatmap as `int8_t`s
+ *
+ */
+__attribute__((target("sse4.1"))) static inline __m128i load_quantised_sse41(
+    const uint8_t* heatmap, size_t p, __m128i flip) {
+  return _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(
+                           &heatmap[p * HEATMAP_CHANNELS])),
+                       flip);
+}
+
+/**
+ * @brief Record pixel `p` as where the `pending` channels set in `equal` were
+ * first found
+ *
+ */
+static inline void found_at(uint32_t equal, size_t p, uint32_t* pending,
+                            uint32_t* index) {
+  uint32_t found = equal & *pending;
+  *pending &= ~found;
+  for (; found; found &= found - 1) {
+    index[__builtin_ctz(found)] = p;
+  }
+}
+
+__attribute__((target("sse4.1"))) static void argmax_quantised_sse41(
+    const uint8_t* heatmap, size_t num_pixels, uint8_t bias, int8_t floor,
+    int8_t* max, uint32_t* index) {
+  const __m128i flip = _mm_set1_epi8(static_cast<char>(bias));
+  const __m128i lowest = _mm_set1_epi8(floor);
+
+  __m128i best = lowest;
+  for (size_t p = 0; p < num_pixels; p++) {
+    best = _mm_max_epi8(best, load_quantised_sse41(heatmap, p, flip));
+  }
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(max), best);
+
+  for (int c = 0; c < HEATMAP_CHANNELS; c++) {
+    index[c] = 0;
+  }
+  uint32_t pending = _mm_movemask_epi8(_mm_cmpgt_epi8(best, lowest));
+  for (size_t p = 0; p < num_pixels && pending; p++) {
+    found_at(_mm_movemask_epi8(_mm_cmpeq_epi8(
+                 load_quantised_sse41(heatmap, p, flip), best)),
+             p, &pending, index);
+  }
+}
+
+/**
+ * @brief Load pixels `p` and `p + 1` of a quantised heatmap as `int8_t`s
+ *
+ */
+__attribute__((target("avx2"))) static inline __m256i load_quantised_avx2(
+    const uint8_t* heatmap, size_t p, __m256i flip) {
+  return _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(
+                              &heatmap[p * HEATMAP_CHANNELS])),
+                          flip);
+}
+
+/**
+ * @brief As `argmax_quantised_sse41()`, for 2 pixels at a time
+ *
+ */
+__attribute__((target("avx2"))) static void argmax_quantised_avx2(
+    const uint8_t* heatmap, size_t num_pixels, uint8_t bias, int8_t floor,
+    int8_t* max, uint32_t* index) {
+  const __m256i flip = _mm256_set1_epi8(static_cast<char>(bias));
+  const __m128i lowest = _mm_set1_epi8(floor);
+
+  __m256i best_pair = _mm256_set1_epi8(floor);
+  size_t p = 0;
+  for (; p + 2 <= num_pixels; p += 2) {
+    best_pair =
+        _mm256_max_epi8(best_pair, load_quantised_avx2(heatmap, p, flip));
+  }
+  __m128i best = _mm_max_epi8(_mm256_castsi256_si128(best_pair),
+                              _mm256_extracti128_si256(best_pair, 1));
+  if (p < num_pixels) {
+    best = _mm_max_epi8(best, load_quantised_sse41(
+                                  heatmap, p, _mm256_castsi256_si128(flip)));
+  }
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(max), best);
+
+  for (int c = 0; c < HEATMAP_CHANNELS; c++) {
+    index[c] = 0;
+  }
+  uint32_t pending = _mm_movemask_epi8(_mm_cmpgt_epi8(best, lowest));
+  best_pair = _mm256_broadcastsi128_si256(best);
+  for (p = 0; p + 2 <= num_pixels && pending; p += 2) {
+    uint32_t equal = _mm256_movemask_epi8(
+        _mm256_cmpeq_epi8(load_quantised_avx2(heatmap, p, flip), best_pair));
+    // In order, so the first pixel is kept
+    found_at(equal & 0xffff, p, &pending, index);
+    found_at(equal >> 16, p + 1, &pending, index);
+  }
+  if (p < num_pixels && pending) {
+    found_at(_mm_movemask_epi8(_mm_cmpeq_epi8(
+                 load_quantised_sse41(heatmap, p, _mm256_castsi256_si128(flip)),
+                 best)),
+             p, &pending, index);
+  }
+}
+#endif
+
+#ifdef ARGMAX_NEON
+/**
+ * @brief Load pixel `p` of a quantised heatmap as `int8_t`s
+ *
+ */
+static inline int8x16_t load_quantised_neon(const uint8_t* heatmap, size_t p,
+                                            uint8x16_t flip) {
+  return vreinterpretq_s8_u8(
+      veorq_u8(vld1q_u8(&heatmap[p * HEATMAP_CHANNELS]), flip));
+}
+
+/**
+ * @brief As `argmax_quantised_sse41()`
+ *
+ */
+static void argmax_quantised_neon(const uint8_t* heatmap, size_t num_pixels,
+                                  uint8_t bias, int8_t floor, int8_t* max,
+                                  uint32_t* index) {
+  const uint8x16_t flip = vdupq_n_u8(bias);
+
+  int8x16_t best = vdupq_n_s8(floor);
+  for (size_t p = 0; p < num_pixels; p++) {
+    best = vmaxq_s8(best, load_quantised_neon(heatmap, p, flip));
+  }
+  vst1q_s8(max, best);
+
+  uint32_t pending = 0;
+  for (int c = 0; c < HEATMAP_CHANNELS; c++) {
+    index[c] = 0;
+    pending |= static_cast<uint32_t>(max[c] > floor) << c;
+  }
+  uint8_t equal[HEATMAP_CHANNELS];
+  for (size_t p = 0; p < num_pixels && pending; p++) {
+    uint8x16_t matches = vceqq_s8(load_quantised_neon(heatmap, p, flip), best);
+    uint64x2_t any = vreinterpretq_u64_u8(matches);
+    if ((vgetq_lane_u64(any, 0) | vgetq_lane_u64(any, 1)) == 0) {
+      continue;
+    }
+    vst1q_u8(equal, matches);
+    for (int c = 0; c < HEATMAP_CHANNELS; c++) {
+      if ((pending >> c & 1) && equal[c]) {
+        index[c] = p;
+        pending &= ~(1u << c);
+      }
+    }
+  }
+}
+#endif
+
+bool argmax_supported(ArgmaxKernel kernel) {
+  switch (kernel) {
+    case ArgmaxScalar:
+      return true;
+#ifdef ARGMAX_X86
+    case ArgmaxSSE41:
+      return __builtin_cpu_supports("sse4.1");
+    case ArgmaxAVX2:
+      return __builtin_cpu_supports("avx2");
+#endif
+#ifdef ARGMAX_NEON
+    case ArgmaxNEON:
+      return true;
+#endif
+    default:
+      return false;
+  }
+}
+
+ArgmaxKernel argmax_best_kernel(void) {
+  static const ArgmaxKernel best = [] {
+    ArgmaxKernel fastest_first[] = {ArgmaxAVX2, ArgmaxSSE41, ArgmaxNEON};
+    for (auto kernel : fastest_first) {
+      if (argmax_supported(kernel)) {
+        return kernel;
+      }
+    }
+    return ArgmaxScalar;
+  }();
+  return best;
+}
+
+void argmax(ArgmaxKernel kernel, const float* heatmap, size_t num_pixels,
+            float max[HEATMAP_CHANNELS], uint32_t index[HEATMAP_CHANNELS]) {
+  switch (kernel) {
+    case ArgmaxScalar:
+      argmax_scalar(heatmap, num_pixels, max, index);
+      return;
+#ifdef ARGMAX_X86
+    case ArgmaxSSE41:
+      argmax_sse41(heatmap, num_pixels, max, index);
+      return;
+    case ArgmaxAVX2:
+      argmax_avx2(heatmap, num_pixels, max, index);
+      return;
+#endif
+#ifdef ARGMAX_NEON
+    case ArgmaxNEON:
+      argmax_neon(heatmap, num_pixels, max, index);
+      return;
+#endif
+    default:
+      throw std::invalid_argument("Argmax kernel not supported");
+  }
+}
+
+void argmax(const float* heatmap, size_t num_pixels,
+            float max[HEATMAP_CHANNELS], uint32_t index[HEATMAP_CHANNELS]) {
+  argmax(argmax_best_kernel(), heatmap, num_pixels, max, index);
+}
+
+void argmax_quantised(ArgmaxKernel kernel, const uint8_t* heatmap,
+                      size_t num_pixels, TensorType type, int32_t zero_point,
+                      int32_t max[HEATMAP_CHANNELS],
+                      uint32_t index[HEATMAP_CHANNELS]) {
+  uint8_t bias;
+  int32_t offset;
+  if (type == UInt8Tensor) {
+    bias = 0x80;
+    offset = 128;
+  } else if (type == Int8Tensor) {
+    bias = 0;
+    offset = 0;
+  } else {
+    throw std::invalid_argument("Heatmap is not quantised");
+  }
+  int8_t floor = std::min(std::max(zero_point - offset, -128), 127);
+
+  int8_t flipped_max[HEATMAP_CHANNELS];
+  switch (kernel) {
+    case ArgmaxScalar:
+      argmax_quantised_scalar(heatmap, num_pixels, bias, floor, flipped_max,
+                              index);
+      break;
+#ifdef ARGMAX_X86
+    case ArgmaxSSE41:
+      argmax_quantised_sse41(heatmap, num_pixels, bias, floor, flipped_max,
+                             index);
+      break;
+    case ArgmaxAVX2:
+      argmax_quantised_avx2(heatmap, num_pixels, bias, floor, flipped_max,
+                            index);
+      break;
+#endif
+#ifdef ARGMAX_NEON
+    case ArgmaxNEON:
+      argmax_quantised_neon(heatmap, num_pixels, bias, floor, flipped_max,
+                            index);
+      break;
+#endif
+    default:
+      throw std::invalid_argument("Argmax kernel not supported");
+  }
+
+  for (int c = 0; c < HEATMAP_CHANNELS; c++) {
+    // The floor stands for the zero point even if it was clamped
+    max[c] = flipped_max[c] == floor ? zero_point : flipped_max[c] + offset;
+  }
+}
+
+void argmax_quantised(const uint8_t* heatmap, size_t num_pixels,
+                      TensorType type, int32_t zero_point,
+                      int32_t max[HEATMAP_CHANNELS],
+                      uint32_t index[HEATMAP_CHANNELS]) {
+  argmax_quantised(argmax_best_kernel(), heatmap, num_pixels, type, zero_point,
+                   max, index);
+}
+
+/**
+ * @brief Offset of the vertex of the parabola through three equally spaced
+ * values, relative to the middle one
+ *
+ * @return `float` In [-0.5..0.5], or 0 if the middle value is not a peak
+ */
+static float parabola_vertex(float before, float middle, float after) {
+  float curvature = before - 2 * middle + after;
+  if (curvature >= 0) {
+    return 0;
+  }
+  float offset = (before - after) / (2 * curvature);
+  return offset < -0.5f ? -0.5f : (offset > 0.5f ? 0.5f : offset);
+}
+
+/**
+ * @brief The value of element `i` of `heatmap`, dequantised if need be
+ *
+ */
+static inline float value_at(const Heatmap& heatmap, size_t i) {
+  switch (heatmap.type) {
+    case UInt8Tensor:
+      return heatmap.quantisation.scale *
+             (static_cast<const uint8_t*>(heatmap.data)[i] -
+              heatmap.quantisation.zero_point);
+    case Int8Tensor:
+      return heatmap.quantisation.scale *
+             (static_cast<const int8_t*>(heatmap.data)[i] -
+              heatmap.quantisation.zero_point);
+    default:
+      return static_cast<const float*>(heatmap.data)[i];
+  }
+}
+
+/**
+ * @brief `argmax()` or `argmax_quantised()`, with the highest values
+ * dequantised
+ *
+ */
+static void find_peaks(const Heatmap& heatmap, size_t num_pixels, float* max,
+                       uint32_t* index) {
+  if (heatmap.type == Float32Tensor) {
+    argmax(static_cast<const float*>(heatmap.data), num_pixels, max, index);
+    return;
+  }
+  int32_t quantised_max[HEATMAP_CHANNELS];
+  argmax_quantised(static_cast<const uint8_t*>(heatmap.data), num_pixels,
+                   heatmap.type, heatmap.quantisation.zero_point,
+                   quantised_max, index);
+  for (int c = 0; c < HEATMAP_CHANNELS; c++) {
+    max[c] = heatmap.quantisation.scale *
+             (quantised_max[c] - heatmap.quantisation.zero_point);
+  }
+}
+
+/**
+ * @brief Refine the position of a peak in one channel of a heatmap
+ *
+ * @param x,y Position of the highest value, replaced by the refined position
+ */
+static void refine(const Heatmap& heatmap, size_t width, size_t height,
+                   int channel, Refinement refinement, float* x, float* y) {
+  auto value = [&](size_t px, size_t py) {
+    return value_at(heatmap, (py * width + px) * HEATMAP_CHANNELS + channel);
+  };
+  size_t px = *x;
+  size_t py = *y;
+
+  if (refinement == QuadraticRefinement) {
+    // Only refined along axes where the peak has neighbours on both sides
+    if (px > 0 && px + 1 < width) {
+      *x += parabola_vertex(value(px - 1, py), value(px, py),
+                            value(px + 1, py));
+    }
+    if (py > 0 && py + 1 < height) {
+      *y += parabola_vertex(value(px, py - 1), value(px, py),
+                            value(px, py + 1));
+    }
+  } else if (refinement == SoftArgmaxRefinement) {
+    size_t left = px > SOFT_ARGMAX_RADIUS ? px - SOFT_ARGMAX_RADIUS : 0;
+    size_t top = py > SOFT_ARGMAX_RADIUS ? py - SOFT_ARGMAX_RADIUS : 0;
+    size_t right = std::min(px + SOFT_ARGMAX_RADIUS, width - 1);
+    size_t bottom = std::min(py + SOFT_ARGMAX_RADIUS, height - 1);
+    float total = 0;
+    float sum_x = 0;
+    float sum_y = 0;
+    for (size_t wy = top; wy <= bottom; wy++) {
+      for (size_t wx = left; wx <= right; wx++) {
+        float weight = std::max(value(wx, wy), 0.0f);
+        total += weight;
+        sum_x += weight * wx;
+        sum_y += weight * wy;
+      }
+    }
+    if (total > 0) {
+      *x = sum_x / total;
+      *y = sum_y / total;
+    }
+  }
+}
+
+/**
+ * @brief Convert the peak of each channel to `InferenceResults`
+ *
+ */
+static InferenceResults to_results(const Heatmap& heatmap, size_t width,
+                                   size_t height, Refinement refinement,
+                                   const float* max, const uint32_t* index) {
+  InferenceResults results;
+  for (int body_part = BodyPartMin; body_part <= BodyPartMax; body_part++) {
+    if (!body_part_used(body_part)) {
+      results.body_parts[body_part] = Coordinate{0, 0, 0};
+      continue;
+    }
+    float x = index[body_part] % width;
+    float y = index[body_part] / width;
+    if (max[body_part] > 0) {
+      refine(heatmap, width, height, body_part, refinement, &x, &y);
+    }
+    results.body_parts[body_part] =
+        Coordinate{x / width, y / height, max[body_part]};
+  }
+  return results;
+}
+
+InferenceResults decode_heatmap(const float* heatmap, size_t width,
+                                size_t height, Refinement refinement) {
+  return decode_heatmap(Heatmap{heatmap, Float32Tensor, Quantisation{1, 0}},
+                        width, height, refinement);
+}
+
+InferenceResults decode_heatmap(Heatmap heatmap, size_t width, size_t height,
+                                Refinement refinement) {
+  float max[HEATMAP_CHANNELS];
+  uint32_t index[HEATMAP_CHANNELS];
+  find_peaks(heatmap, width * height, max, index);
+  return to_results(heatmap, width, height, refinement, max, index);
+}
+
+HeatmapDecoder::HeatmapDecoder(size_t width, size_t height,
+                               Refinement refinement, LocalSearch search)
+    : width(width),
+      height(height),
+      refinement(refinement),
+      search(search),
+      full_scans(Metrics::counter("inference.heatmap_full_scans")) {}
+
+bool HeatmapDecoder::search_locally(const Heatmap& heatmap,
+                                    PreProcessing::Region region,
+                                    int channel, float* max,
+                                    uint32_t* index) {
+  // Where the body part was last found, in pixels of this heatmap
+  float x = (previous[channel].x - region.x) / region.width * width;
+  float y = (previous[channel].y - region.y) / region.height * height;
+  if (!(x >= 0 && x < width && y >= 0 && y < height)) {
+    // Outside of the region the model was given
+    return false;
+  }
+  size_t px = x;
+  size_t py = y;
+  size_t left = px > search.radius ? px - search.radius : 0;
+  size_t top = py > search.radius ? py - search.radius : 0;
+  size_t right = std::min(px + search.radius, width - 1);
+  size_t bottom = std::min(py + search.radius, height - 1);
+
+  // In the same order as `argmax()`, so the first of equal values is kept
+  float best = 0;
+  uint32_t best_index = py * width + px;
+  for (size_t wy = top; wy <= bottom; wy++) {
+    for (size_t wx = left; wx <= right; wx++) {
+      uint32_t i = wy * width + wx;
+      float value = value_at(heatmap, i * HEATMAP_CHANNELS + channel);
+      if (value > best) {
+        best = value;
+        best_index = i;
+      }
+    }
+  }
+
+  *max = best;
+  *index = best_index;
+  return best >= search.min_confidence;
+}
+
+InferenceResults HeatmapDecoder::decode(const float* heatmap,
+                                        PreProcessing::Region region) {
+  return decode(Heatmap{heatmap, Float32Tensor, Quantisation{1, 0}}, region);
+}
+
+InferenceResults HeatmapDecoder::decode(Heatmap heatmap,
+                                        PreProcessing::Region region) {
+  float max[HEATMAP_CHANNELS];
+  uint32_t index[HEATMAP_CHANNELS];
+  bool full_scan = !have_previous || search.radius == 0 ||
+                   frames_since_full_scan + 1 >= search.full_scan_period;
+  for (int c = 0; c < HEATMAP_CHANNELS && !full_scan; c++) {
+    if (!body_part_used(c)) {
+      max[c] = 0;
+      index[c] = 0;
+      continue;
+    }
+    full_scan = !search_locally(heatmap, region, c, &max[c], &index[c]);
+  }
+
+  if (full_scan) {
+    find_peaks(heatmap, width * height, max, index);
+    full_scans.add();
+    frames_since_full_scan = 0;
+    have_previous = true;
+  } else {
+    frames_since_full_scan++;
+  }
+  last_full_scan = full_scan;
+
+  // Remember the peaks relative to the whole frame, as the next frame may be
+  // cropped differently
+  for (int c = 0; c < HEATMAP_CHANNELS; c++) {
+    previous[c] = Position{
+        region.x + (index[c] % width + 0.5f) / width * region.width,
+        region.y + (index[c] / width + 0.5f) / height * region.height};
+  }
+  return to_results(heatmap, width, height, refinement, max, index);
+}
+
+bool HeatmapDecoder::last_was_full_scan(void) { return last_full_scan; }
+
+void HeatmapDecoder::resize(size_t width, size_t height) {
+  this->width = width;
+  this->height = height;
+}
+
+}  // namespace Inference
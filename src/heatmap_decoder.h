@@ -0,0 +1,347 @@
+/**
+ * @file heatmap_decoder.h
+ * @brief Vectorised decoding of the model's output heatmaps into body part
+ * positions
+ *
+ * @copyright Copyright (C) 2021  Miklas Riechmann
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef SRC_HEATMAP_DECODER_H_
+#define SRC_HEATMAP_DECODER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "intermediate_structures.h"
+#include "metrics.h"
+
+/**
+ * @brief Number of channels of the heatmap, one per `BodyPart`
+ *
+ */
+#define HEATMAP_CHANNELS (BodyPartMax + 1)
+
+/**
+ * @brief Half the size of the window `SoftArgmaxRefinement` averages over
+ *
+ */
+#define SOFT_ARGMAX_RADIUS 2
+
+/**
+ * @brief Suggested `LocalSearch` settings
+ *
+ * Windows of 17x17 pixels of a 224x224 heatmap, and the pipeline's default
+ * confidence threshold
+ *
+ */
+#define LOCAL_SEARCH_RADIUS 8
+#define LOCAL_SEARCH_MIN_CONFIDENCE 0.1
+#define LOCAL_SEARCH_PERIOD 15
+
+namespace Inference {
+
+/**
+ * @brief Implementations of `argmax()`
+ *
+ * All kernels produce identical output. The vectorised kernels compare all
+ * `HEATMAP_CHANNELS` channels of a pixel at once.
+ *
+ */
+enum ArgmaxKernel {
+  ArgmaxScalar,
+  ArgmaxSSE41,  ///< x86 with SSE4.1, 4 channels per register
+  ArgmaxAVX2,   ///< x86 with AVX2, 8 channels per register
+  ArgmaxNEON,   ///< ARM with NEON, 4 channels per register
+};
+
+/**
+ * @brief Check if `kernel` can run on this CPU
+ *
+ */
+bool argmax_supported(ArgmaxKernel kernel);
+
+/**
+ * @brief The fastest kernel this CPU supports, detected once at run time
+ *
+ */
+ArgmaxKernel argmax_best_kernel(void);
+
+/**
+ * @brief Find the pixel with the highest value in each channel of a heatmap
+ *
+ * Values that are not positive are ignored, so a channel without any positive
+ * value has a maximum of 0 at pixel 0.
+ *
+ * @param kernel Implementation to use, must be supported
+ * @param heatmap `num_pixels` pixels with `HEATMAP_CHANNELS` interleaved
+ * channels
+ * @param num_pixels Number of pixels in `heatmap`
+ * @param max Output for the highest value in each channel
+ * @param index Output for the index of the first pixel with the highest value
+ * in each channel
+ */
+void argmax(ArgmaxKernel kernel, const float* heatmap, size_t num_pixels,
+            float max[HEATMAP_CHANNELS], uint32_t index[HEATMAP_CHANNELS]);
+
+/**
+ * @brief Find the pixel with the highest value in each channel of a heatmap,
+ * using the fastest kernel
+ *
+ */
+void argmax(const float* heatmap, size_t num_pixels,
+            float max[HEATMAP_CHANNELS], uint32_t index[HEATMAP_CHANNELS]);
+
+/**
+ * @brief Find the pixel with the highest value in each channel of a quantised
+ * heatmap
+ *
+ * As `argmax()`, comparing the integers directly as the quantisation
+ * preserves their order. Integers that are not greater than `zero_point`,
+ * i.e. values that are not positive, are ignored. The vectorised kernels
+ * compare all channels of a pixel in a single register.
+ *
+ * @param kernel Implementation to use, must be supported
+ * @param heatmap `num_pixels` pixels with `HEATMAP_CHANNELS` interleaved
+ * channels of `type`
+ * @param num_pixels Number of pixels in `heatmap`
+ * @param type `UInt8Tensor` or `Int8Tensor`
+ * @param zero_point Of the heatmap's `Quantisation`
+ * @param max Output for the highest integer in each channel, `zero_point` if
+ * none is greater
+ * @param index Output for the index of the first pixel with the highest
+ * integer in each channel
+ * @throw `std::invalid_argument` if `type` is not quantised
+ */
+void argmax_quantised(ArgmaxKernel kernel, const uint8_t* heatmap,
+                      size_t num_pixels, TensorType type, int32_t zero_point,
+                      int32_t max[HEATMAP_CHANNELS],
+                      uint32_t index[HEATMAP_CHANNELS]);
+
+/**
+ * @brief Find the pixel with the highest value in each channel of a quantised
+ * heatmap, using the fastest kernel
+ *
+ */
+void argmax_quantised(const uint8_t* heatmap, size_t num_pixels,
+                      TensorType type, int32_t zero_point,
+                      int32_t max[HEATMAP_CHANNELS],
+                      uint32_t index[HEATMAP_CHANNELS]);
+
+/**
+ * @brief View of the model's output, in any `TensorType`
+ *
+ */
+struct Heatmap {
+  /**
+   * @brief Pixels with `HEATMAP_CHANNELS` interleaved channels of `type`
+   *
+   */
+  const void* data;
+  TensorType type;
+  Quantisation quantisation;  ///< Of `data`, if `type` is quantised
+};
+
+/**
+ * @brief How positions are refined beyond the pixel with the highest value
+ *
+ */
+enum Refinement {
+  /**
+   * @brief Use the pixel with the highest value, so positions are only as
+   * precise as the heatmap's resolution
+   *
+   */
+  NoRefinement,
+
+  /**
+   * @brief Fit a parabola through the highest value and its neighbours, along
+   * each axis
+   *
+   */
+  QuadraticRefinement,
+
+  /**
+   * @brief Take the mean position of the positive values within
+   * `SOFT_ARGMAX_RADIUS` pixels of the highest, weighted by value
+   *
+   */
+  SoftArgmaxRefinement,
+};
+
+/**
+ * @brief Find the most likely position of each body part
+ *
+ * Only body parts that a `Joint` is derived from are decoded, see
+ * `joint_body_parts`. The others are at (0, 0) with a confidence of 0.
+ *
+ * @param heatmap Output of the model, `width` by `height` pixels with a
+ * channel per `BodyPart`
+ * @param width Width of `heatmap` in pixels
+ * @param height Height of `heatmap` in pixels
+ * @param refinement How to find positions between pixels
+ * @return `InferenceResults` with *relative* positions, and the highest value
+ * of the heatmap as the confidence
+ */
+InferenceResults decode_heatmap(const float* heatmap, size_t width,
+                                size_t height,
+                                Refinement refinement = NoRefinement);
+
+/**
+ * @brief Find the most likely position of each body part in a heatmap of any
+ * `TensorType`
+ *
+ * Quantised heatmaps are searched without converting them to `float`s, only
+ * the peaks are converted.
+ *
+ */
+InferenceResults decode_heatmap(Heatmap heatmap, size_t width, size_t height,
+                                Refinement refinement = NoRefinement);
+
+/**
+ * @brief Settings of the local search of `HeatmapDecoder`
+ *
+ */
+struct LocalSearch {
+  /**
+   * @brief Half the size of the window searched around each body part's last
+   * position. 0 always searches the whole heatmap
+   *
+   */
+  size_t radius;
+
+  /**
+   * @brief The whole heatmap is searched if the peak in any window is lower
+   *
+   */
+  float min_confidence;
+
+  /**
+   * @brief The whole heatmap is searched at least once every this many frames
+   *
+   */
+  uint64_t full_scan_period;
+};
+
+/**
+ * @brief Finds body parts in a sequence of heatmaps, searching near where they
+ * were last found
+ *
+ * The user hardly moves from one frame to the next, so each body part is
+ * first searched for within `LocalSearch::radius` pixels of where it was last
+ * found. The whole heatmap is searched with `argmax()` instead for the first
+ * frame, every `LocalSearch::full_scan_period` frames, and whenever the peak
+ * of any window is below `LocalSearch::min_confidence` or a body part was last
+ * found outside of the region the model was given. Body parts that no `Joint`
+ * is derived from are not searched for, so they never force a full search.
+ *
+ * Whenever the highest value of a channel lies within its window, the same
+ * highest value is found as by searching the whole heatmap, though not
+ * necessarily at the same pixel: if the value also occurs outside of the
+ * window, `argmax()` finds the first in the whole heatmap, whereas the local
+ * search finds the first within the window. Quantised heatmaps often have
+ * such ties.
+ *
+ * Not thread safe, use one per `InferenceCore`.
+ *
+ */
+class HeatmapDecoder {
+ private:
+  size_t width;
+  size_t height;
+  Refinement refinement;
+  LocalSearch search;
+
+  /**
+   * @brief A *relative* position in the whole frame
+   *
+   */
+  struct Position {
+    float x;
+    float y;
+  };
+
+  bool have_previous = false;
+  uint64_t frames_since_full_scan = 0;
+  bool last_full_scan = false;
+  Position previous[HEATMAP_CHANNELS];  ///< Where each body part was found
+
+  Metrics::Counter& full_scans;
+
+  /**
+   * @brief Search the window around where `channel` was last found
+   *
+   * @param max,index Output for the peak of the window
+   * @return `true` if the peak is at least `LocalSearch::min_confidence`
+   */
+  bool search_locally(const Heatmap& heatmap, PreProcessing::Region region,
+                      int channel, float* max, uint32_t* index);
+
+ public:
+  /**
+   * @brief Construct a new `HeatmapDecoder` object
+   *
+   * @param width Width of the heatmaps in pixels
+   * @param height Height of the heatmaps in pixels
+   * @param refinement How to find positions between pixels
+   * @param search Where to search, by default always the whole heatmap
+   */
+  HeatmapDecoder(size_t width, size_t height,
+                 Refinement refinement = NoRefinement,
+                 LocalSearch search = LocalSearch{0, 0, 1});
+
+  /**
+   * @brief Find the most likely position of each body part, as
+   * `decode_heatmap()`
+   *
+   * @param heatmap Output of the model for the next frame
+   * @param region Region of the frame the model was given, see
+   * `PreProcessing::RoiTracker`
+   * @return `InferenceResults` Positions relative to `region`
+   */
+  InferenceResults decode(const float* heatmap,
+                          PreProcessing::Region region = PreProcessing::Region{
+                              0, 0, 1, 1});
+
+  /**
+   * @brief As above, for a heatmap of any `TensorType`
+   *
+   */
+  InferenceResults decode(Heatmap heatmap,
+                          PreProcessing::Region region = PreProcessing::Region{
+                              0, 0, 1, 1});
+
+  /**
+   * @brief Whether the last `decode()` searched the whole heatmap
+   *
+   */
+  bool last_was_full_scan(void);
+
+  /**
+   * @brief Change the size of the heatmaps to decode from the next `decode()`
+   *
+   * Where body parts were last found is kept, relative to the frame, so the
+   * local search carries on at the new size.
+   *
+   * @param width Width of the heatmaps in pixels
+   * @param height Height of the heatmaps in pixels
+   */
+  void resize(size_t width, size_t height);
+};
+
+}  // namespace Inference
+
+#endif  // SRC_HEATMAP_DECODER_H_
@@ -19,101 +19,246 @@
 #include "inference_core.h"
 
 #include <create_op_resolver.h>
-#include <model_builder.h>
-#include <op_resolver.h>
-#include <stderr_reporter.h>
+#ifdef ENABLE_XNNPACK
+#include <delegates/xnnpack/xnnpack_delegate.h>
+#endif
 #include <stdio.h>
 
+#include <chrono>  //NOLINT [build/c++11]
 #include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
 
 #include "intermediate_structures.h"
+#include "metrics.h"
+#include "trace.h"
 
 namespace Inference {
 
-InferenceCore::InferenceCore(const char* model_filename,
+Model::Model(const char* model_filename) {
+  flatbuffer =
+      tflite::FlatBufferModel::BuildFromFile(model_filename, &error_reporter);
+  if (!flatbuffer) {
+    throw std::runtime_error(std::string("Could not load model ") +
+                             model_filename);
+  }
+  resolver = tflite::CreateOpResolver();
+}
+
+std::unique_ptr<tflite::Interpreter> Model::build_interpreter(
+    int num_threads) const {
+  std::unique_ptr<tflite::Interpreter> interpreter;
+  if (tflite::InterpreterBuilder(*flatbuffer, *resolver)(
+          &interpreter, num_threads) != kTfLiteOk) {
+    throw std::runtime_error("Could not start interpreter");
+  }
+  return interpreter;
+}
+
+/**
+ * @brief The `TensorType` of `tensor`
+ *
+ * @param quantisation Output for the tensor's quantisation, if any
+ * @throw `std::runtime_error` if the type is not supported
+ */
+static TensorType tensor_type(const TfLiteTensor* tensor,
+                              Quantisation* quantisation) {
+  *quantisation = Quantisation{tensor->params.scale, tensor->params.zero_point};
+  switch (tensor->type) {
+    case kTfLiteFloat32:
+      return Float32Tensor;
+    case kTfLiteUInt8:
+      return UInt8Tensor;
+    case kTfLiteInt8:
+      return Int8Tensor;
+    default:
+      throw std::runtime_error(
+          "Model tensors must be of type float32, uint8 or int8");
+  }
+}
+
+InferenceCore::InferenceCore(std::shared_ptr<const Model> model,
                              size_t model_input_width,
-                             size_t model_input_height) {
+                             size_t model_input_height, int num_threads,
+                             Refinement refinement, LocalSearch search,
+                             size_t batch_size)
+    : model_input_width(model_input_width),
+      model_input_height(model_input_height),
+      model_input_size(model_input_width * model_input_height),
+      batch_size(batch_size),
+      num_threads(num_threads),
+      decoder(model_input_width, model_input_height, refinement, search) {
+  if (batch_size == 0) {
+    throw std::invalid_argument("batch_size must not be zero");
+  }
+  load(std::move(model), model_input_width, model_input_height);
+}
+
+void InferenceCore::load(std::shared_ptr<const Model> model,
+                         size_t model_input_width,
+                         size_t model_input_height) {
+  // Declared first so that it outlives the interpreter that uses it
+  std::unique_ptr<TfLiteDelegate, void (*)(TfLiteDelegate*)> loaded_delegate{
+      nullptr, nullptr};
+  std::unique_ptr<tflite::Interpreter> loaded =
+      model->build_interpreter(num_threads);
+  if (loaded->ResizeInputTensor(
+          loaded->inputs()[0],
+          {static_cast<int>(batch_size), static_cast<int>(model_input_height),
+           static_cast<int>(model_input_width), model_input_channels}) !=
+      kTfLiteOk) {
+    throw std::runtime_error("Could not resize the model's input");
+  }
+
+#ifdef ENABLE_XNNPACK
+  TfLiteXNNPackDelegateOptions options = TfLiteXNNPackDelegateOptionsDefault();
+  options.num_threads = num_threads;
+  loaded_delegate = std::unique_ptr<TfLiteDelegate, void (*)(TfLiteDelegate*)>(
+      TfLiteXNNPackDelegateCreate(&options), TfLiteXNNPackDelegateDelete);
+  if (loaded->ModifyGraphWithDelegate(loaded_delegate.get()) != kTfLiteOk) {
+    throw std::runtime_error("Could not apply the XNNPACK delegate");
+  }
+#endif
+
+  if (loaded->AllocateTensors() != kTfLiteOk) {
+    throw std::runtime_error("Could not allocate tensors");
+  }
+
+  Quantisation loaded_input_quantisation;
+  Quantisation loaded_output_quantisation;
+  TensorType loaded_input_type =
+      tensor_type(loaded->input_tensor(0), &loaded_input_quantisation);
+  TensorType loaded_output_type =
+      tensor_type(loaded->output_tensor(0), &loaded_output_quantisation);
+
+  // Nothing can fail from here, so the previous model is kept on any error.
+  // The old interpreter uses the old delegate, so must be destroyed first
+  interpreter.reset();
+  delegate = std::move(loaded_delegate);
+  interpreter = std::move(loaded);
+  this->model = std::move(model);
+  input_type = loaded_input_type;
+  input_quantisation = loaded_input_quantisation;
+  output_type = loaded_output_type;
+  output_quantisation = loaded_output_quantisation;
   this->model_input_width = model_input_width;
   this->model_input_height = model_input_height;
-  this->model_input_size = model_input_width * model_input_height;
+  model_input_size = model_input_width * model_input_height;
+}
 
-  // Load the model
-  auto model =
-      tflite::FlatBufferModel::BuildFromFile(model_filename, &error_reporter);
-  this->model.swap(model);
+PreProcessing::PreProcessedImage InferenceCore::input(size_t index) {
+  size_t offset = index * model_input_size * model_input_channels;
+  if (input_type == Float32Tensor) {
+    return PreProcessing::PreProcessedImage{
+        this->interpreter->typed_input_tensor<float>(0) + offset, nullptr,
+        Float32Tensor, input_quantisation};
+  }
+  return PreProcessing::PreProcessedImage{
+      nullptr, this->interpreter->input_tensor(0)->data.uint8 + offset,
+      input_type, input_quantisation};
+}
 
-  auto resolver = tflite::CreateOpResolver();
+size_t InferenceCore::get_batch_size(void) { return batch_size; }
 
-  // Start the interpreter
-  if (tflite::InterpreterBuilder(
-          *(this->model), *resolver)(&(this->interpreter)) != kTfLiteOk) {
-    // Return failure.
-    fprintf(stderr, "Could not start interpreter\n");
-    exit(EXIT_FAILURE);
-  }
+size_t InferenceCore::get_input_width(void) { return model_input_width; }
 
-  this->interpreter->AllocateTensors();
+size_t InferenceCore::get_input_height(void) { return model_input_height; }
+
+bool InferenceCore::resize_input_tensor(void) {
+  return interpreter->ResizeInputTensor(
+             interpreter->inputs()[0],
+             {static_cast<int>(batch_size),
+              static_cast<int>(model_input_height),
+              static_cast<int>(model_input_width), model_input_channels}) ==
+         kTfLiteOk;
+}
+
+void InferenceCore::resize_input(size_t model_input_width,
+                                 size_t model_input_height) {
+  size_t previous_width = this->model_input_width;
+  size_t previous_height = this->model_input_height;
+  this->model_input_width = model_input_width;
+  this->model_input_height = model_input_height;
+  if (!resize_input_tensor() || interpreter->AllocateTensors() != kTfLiteOk) {
+    this->model_input_width = previous_width;
+    this->model_input_height = previous_height;
+    if (resize_input_tensor()) {
+      interpreter->AllocateTensors();
+    }
+    throw std::runtime_error("Could not resize the model's input");
+  }
+  model_input_size = model_input_width * model_input_height;
+  decoder.resize(model_input_width, model_input_height);
 }
 
-Coordinate InferenceCore::pixel_coord_to_Coordinate(uint32_t x, uint32_t y,
-                                                    float confidence) {
-  return Coordinate{
-      static_cast<float>(x) / static_cast<float>(this->model_input_width),
-      static_cast<float>(y) / static_cast<float>(this->model_input_height),
-      confidence};
+std::shared_ptr<const Model> InferenceCore::get_model(void) { return model; }
+
+void InferenceCore::set_model(std::shared_ptr<const Model> model,
+                              size_t model_input_width,
+                              size_t model_input_height) {
+  load(std::move(model), model_input_width, model_input_height);
+  decoder.resize(model_input_width, model_input_height);
 }
 
 InferenceResults InferenceCore::run(
-    PreProcessing::PreProcessedImage preprocessed_image) {
-  // Initialise and get pointer to input
-  auto input = this->interpreter->typed_input_tensor<float>(0);
-
-  size_t size = this->model_input_size;
-
-  // Copy the image to the input
-  memcpy(
-      input, preprocessed_image.image,
-      size * this->model_input_channels * sizeof(preprocessed_image.image[0]));
-
-  // Free the memory allocated for the image as it is no longer needed
-  free(preprocessed_image.image);
-
-  // Run the model
-  this->interpreter->Invoke();
-
-  // Get pointer to output
-  auto output = this->interpreter->typed_output_tensor<float>(0);
-
-  Inference::Result results[BodyPartMax + 1];
-  memset(results, 0, sizeof(results));
-
-  size_t step = BodyPartMax + 1;
-  size_t width = this->model_input_width;
-  size_t height = this->model_input_height;
-
-  // Go through output to find where largest confidence for each body part is
-  // Step through each pixel
-  for (uint32_t i = 0; i < size * step; i += step) {
-    // Look at predictions for each body part in current pixel
-    for (int body_part = BodyPartMin; body_part <= BodyPartMax; body_part++) {
-      float out = output[i + body_part];
-      if (out > results[body_part].confidence) {
-        results[body_part] = {out, (i / step) % width, (i / step) / height};
-      }
+    PreProcessing::PreProcessedImage preprocessed_image,
+    PreProcessing::Region region) {
+  if (preprocessed_image.type != input_type) {
+    throw std::invalid_argument("Image is not of the model's input type");
+  }
+
+  // Copy the image to the input, unless it was pre processed in place
+  auto input = this->input();
+  size_t size = this->model_input_size * this->model_input_channels;
+  if (input_type == Float32Tensor) {
+    if (preprocessed_image.image != input.image) {
+      memcpy(input.image, preprocessed_image.image,
+             size * sizeof(preprocessed_image.image[0]));
     }
+  } else if (preprocessed_image.quantised != input.quantised) {
+    memcpy(input.quantised, preprocessed_image.quantised, size);
   }
 
-  InferenceResults results_out;
+  uint64_t frame = Trace::frame();
+  return run_batch(1, &region, &frame)[0];
+}
 
-  int body_part_index = BodyPartMin;
-  for (auto& body_part : results_out.body_parts) {
-    body_part = pixel_coord_to_Coordinate(results[body_part_index].x,
-                                          results[body_part_index].y,
-                                          results[body_part_index].confidence);
-    body_part_index++;
+std::vector<InferenceResults> InferenceCore::run_batch(
+    size_t count, const PreProcessing::Region* regions,
+    const uint64_t* frames) {
+  if (count > batch_size) {
+    throw std::invalid_argument("More images than the batch size");
   }
 
-  return results_out;
+  // Run the model, which every frame of the batch spends waiting on
+  {
+    static Metrics::Histogram& invoke_us =
+        Metrics::histogram("inference.invoke_us");
+    auto start = std::chrono::steady_clock::now();
+    if (this->interpreter->Invoke() != kTfLiteOk) {
+      throw std::runtime_error("Could not run the model");
+    }
+    invoke_us.record_since(start);
+    for (size_t i = 0; i < count; i++) {
+      TRACE_COMPLETE("Invoke", frames[i], start, TRACE_NOW(),
+                     Trace::thread_id());
+    }
+  }
+
+  // Find where each body part is most likely to be, searching quantised
+  // heatmaps without converting them
+  const uint8_t* output = this->interpreter->output_tensor(0)->data.uint8;
+  size_t heatmap_bytes = model_input_size * HEATMAP_CHANNELS *
+                         (output_type == Float32Tensor ? sizeof(float) : 1);
+  std::vector<InferenceResults> results;
+  for (size_t i = 0; i < count; i++) {
+    TRACE_SPAN("Decode", frames[i]);
+    Heatmap heatmap{output + i * heatmap_bytes, output_type,
+                    output_quantisation};
+    results.push_back(decoder.decode(heatmap, regions[i]));
+  }
+  return results;
 }
 
 }  // namespace Inference
@@ -23,10 +23,15 @@
 #define SRC_INFERENCE_CORE_H_
 
 #include <interpreter_builder.h>
+#include <model_builder.h>
+#include <op_resolver.h>
+#include <stderr_reporter.h>
 #include <stdint.h>
 
 #include <memory>
+#include <vector>
 
+#include "heatmap_decoder.h"
 #include "intermediate_structures.h"
 #include "pre_processor.h"
 
@@ -37,6 +42,49 @@
  */
 namespace Inference {
 
+/**
+ * @brief A TensorFlow Lite model, loaded once and shared by every
+ * `InferenceCore` that runs it
+ *
+ * Immutable once loaded, so it is safe to build interpreters from it on any
+ * number of threads. Each `InferenceCore` holds a reference so that the model
+ * outlives the interpreters built from it.
+ *
+ */
+class Model {
+ private:
+  /**
+   * @brief Referred to by `flatbuffer`, so must be declared before it
+   *
+   */
+  tflite::StderrReporter error_reporter;
+  std::unique_ptr<tflite::FlatBufferModel> flatbuffer;
+  std::unique_ptr<tflite::OpResolver> resolver;
+
+ public:
+  /**
+   * @brief Load a model
+   *
+   * @param model_filename Path to the TensorFlow Lite model
+   * @throw `std::runtime_error` if the model cannot be loaded
+   */
+  explicit Model(const char* model_filename);
+
+  Model(const Model&) = delete;
+  Model& operator=(const Model&) = delete;
+
+  /**
+   * @brief Build an interpreter to run the model with
+   *
+   * @param num_threads Number of threads the interpreter may use to run each
+   * operation
+   * @return `std::unique_ptr<tflite::Interpreter>` without tensors allocated
+   * @throw `std::runtime_error` if the interpreter cannot be built
+   */
+  std::unique_ptr<tflite::Interpreter> build_interpreter(
+      int num_threads) const;
+};
+
 /**
  * @brief A wrapper to make running inference easier
  *
@@ -46,6 +94,11 @@ namespace Inference {
  * values to `float`s in the interval [-1..1] before being run through a
  * `InferenceCore` object.
  *
+ * Fully quantised models, with `uint8_t` or `int8_t` input and output tensors,
+ * are detected from the tensors and run without any `float` conversion: the
+ * image is quantised instead of normalised, see `input()`, and the heatmaps
+ * are searched as integers.
+ *
  */
 class InferenceCore {
  private:
@@ -53,33 +106,186 @@ class InferenceCore {
   size_t model_input_height;
   size_t model_input_size;
   uint8_t model_input_channels = 3;
-  std::unique_ptr<tflite::Interpreter> interpreter;
-  tflite::StderrReporter error_reporter;
-  std::unique_ptr<tflite::FlatBufferModel> model;
+  size_t batch_size;
+  int num_threads;
+
+  /**
+   * @brief Types of the model's input and output, detected when it is loaded
+   *
+   */
+  TensorType input_type = Float32Tensor;
+  Quantisation input_quantisation = Quantisation{1, 0};
+  TensorType output_type = Float32Tensor;
+  Quantisation output_quantisation = Quantisation{1, 0};
+
+  HeatmapDecoder decoder;
+  std::shared_ptr<const Model> model;
+
+  /**
+   * @brief Resize the input tensor to `batch_size` images of
+   * `model_input_width` by `model_input_height`, to take effect once the
+   * tensors are next allocated
+   *
+   * @return `true` if successful
+   */
+  bool resize_input_tensor(void);
 
-  Coordinate pixel_coord_to_Coordinate(uint32_t x, uint32_t y,
-                                       float confidence);
+  /**
+   * @brief Build an interpreter for `model` with an input of the given size,
+   * and replace the current one with it
+   *
+   * @throw `std::runtime_error` if the interpreter cannot be built, in which
+   * case the current one is kept
+   */
+  void load(std::shared_ptr<const Model> model, size_t model_input_width,
+            size_t model_input_height);
+
+  /**
+   * @brief Delegate that runs the model instead of the built in kernels, if
+   * any
+   *
+   * Used by `interpreter`, so must be declared before it
+   *
+   */
+  std::unique_ptr<TfLiteDelegate, void (*)(TfLiteDelegate*)> delegate{
+      nullptr, nullptr};
+  std::unique_ptr<tflite::Interpreter> interpreter;
 
  public:
   /**
    * @brief Construct a new Inference Core object
    *
-   * @param model_filename Path to the TensorFlow Lite model
+   * Only the interpreter and its tensors belong to the new object, so any
+   * number of them can share one `Model`.
+   *
+   * When built with `ENABLE_XNNPACK` the model is run by the XNNPACK
+   * delegate, otherwise by the built in kernels. Either way `num_threads`
+   * threads are used within each operation: several single threaded cores
+   * give the best throughput, a single multi threaded core the lowest latency.
+   *
+   * @param model The model to run
    * @param model_input_width Width of the input to the model
    * @param model_input_height Height of the input to the model
+   * @param num_threads Number of threads to run each operation on
+   * @param refinement How to find body parts between pixels of the model's
+   * output
+   * @param search Where to search the model's output for body parts, see
+   * `HeatmapDecoder`. By default the whole output is always searched
+   * @param batch_size Number of images run by each `Invoke()` of the model,
+   * see `run_batch()`
+   * @throw `std::runtime_error` if the interpreter cannot be built, or the
+   * model's tensors are not `float32`, `uint8` or `int8`
+   * @throw `std::invalid_argument` if `batch_size` is zero
+   */
+  InferenceCore(std::shared_ptr<const Model> model, size_t model_input_width,
+                size_t model_input_height, int num_threads = 1,
+                Refinement refinement = NoRefinement,
+                LocalSearch search = LocalSearch{0, 0, 1},
+                size_t batch_size = 1);
+
+  /**
+   * @brief Get the model's input tensor, for pre processing to write into
+   *
+   * @param index Which image of the batch to get
+   * @return `PreProcessing::PreProcessedImage` View onto the input tensor,
+   * valid for the lifetime of this object, with the tensor's `TensorType` and
+   * `Quantisation`
+   */
+  PreProcessing::PreProcessedImage input(size_t index = 0);
+
+  /**
+   * @brief Get the number of images the model is run on at once
+   *
+   */
+  size_t get_batch_size(void);
+
+  /**
+   * @brief Get the width of the model's input
+   *
+   */
+  size_t get_input_width(void);
+
+  /**
+   * @brief Get the height of the model's input
+   *
+   */
+  size_t get_input_height(void);
+
+  /**
+   * @brief Change the resolution of the model's input, and hence of its
+   * output, for the following runs
+   *
+   * Reallocates the tensors, so every `input()` obtained before is invalid
+   * afterwards. Must not be called while the model runs.
+   *
+   * @param model_input_width New width of the input to the model
+   * @param model_input_height New height of the input to the model
+   * @throw `std::runtime_error` if the model cannot run at that resolution, in
+   * which case the previous resolution is kept
+   */
+  void resize_input(size_t model_input_width, size_t model_input_height);
+
+  /**
+   * @brief Get the model being run
+   *
+   */
+  std::shared_ptr<const Model> get_model(void);
+
+  /**
+   * @brief Run a different model, at the given resolution, for the following
+   * runs
+   *
+   * A new interpreter is built, so every `input()` obtained before is invalid
+   * afterwards. Where body parts were last found is kept, as for
+   * `resize_input()`. Must not be called while the model runs.
+   *
+   * @param model The model to run instead
+   * @param model_input_width Width of the input to `model`
+   * @param model_input_height Height of the input to `model`
+   * @throw `std::runtime_error` if the interpreter cannot be built, or the
+   * model's tensors are not supported, in which case the current model is kept
+   */
+  void set_model(std::shared_ptr<const Model> model, size_t model_input_width,
+                 size_t model_input_height);
+
+  /**
+   * @brief Run the images already written to the first `count` `input()`s of
+   * the batch through the model, in a single `Invoke()`
+   *
+   * The whole batch is run even if `count` is smaller, so a partial batch
+   * takes as long as a full one. Images are decoded in order, so they should
+   * be given in the order of the frames they come from.
+   *
+   * @param count Number of images, at most `get_batch_size()`
+   * @param regions Region of the frame that each image shows
+   * @param frames ID of the frame that each image shows, to label its events
+   * in the trace with
+   * @return `std::vector<InferenceResults>` Positions of each image, relative
+   * to its region
+   * @throw `std::invalid_argument` if `count` is larger than the batch
+   * @throw `std::runtime_error` if running the model fails, in which case its
+   * output is not decoded
    */
-  InferenceCore(const char* model_filename, size_t model_input_width,
-                size_t model_input_height);
+  std::vector<InferenceResults> run_batch(size_t count,
+                                          const PreProcessing::Region* regions,
+                                          const uint64_t* frames);
 
   /**
    * @brief Run a pre-processed image through the loaded model
    *
    * @param preprocessed_image An image that has been resized to the model input
    * dimensions and normalised from `uint8_t` values to `float`s in the interval
-   * [-1..1] before being passed to this function
-   * @return `InferenceResults`
+   * [-1..1], or quantised like `input()`, before being passed to this
+   * function. Best written directly into `input()`, otherwise it is copied
+   * there
+   * @param region Region of the frame that `preprocessed_image` shows
+   * @return `InferenceResults` Positions relative to `region`
+   * @throw `std::invalid_argument` if `preprocessed_image` is not of the
+   * model's input type
    */
-  InferenceResults run(PreProcessing::PreProcessedImage preprocessed_image);
+  InferenceResults run(
+      PreProcessing::PreProcessedImage preprocessed_image,
+      PreProcessing::Region region = PreProcessing::Region{0, 0, 1, 1});
 };
 }  // namespace Inference
 
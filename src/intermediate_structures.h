@@ -23,6 +23,9 @@
 #ifndef SRC_INTERMEDIATE_STRUCTURES_H_
 #define SRC_INTERMEDIATE_STRUCTURES_H_
 
+#include <stddef.h>
+#include <stdint.h>
+
 #include <array>
 #include <string>
 
@@ -74,6 +77,83 @@ enum Joint {
   JointMax = Foot
 };
 
+/**
+ * @brief The `BodyPart`s a `Joint` is derived from
+ *
+ */
+struct JointBodyParts {
+  /**
+   * @brief In the order they are averaged, see
+   * `PostProcessing::PostProcessor::run()`
+   *
+   */
+  BodyPart body_parts[3];
+  size_t count;  ///< Number of `body_parts` used
+};
+
+/**
+ * @brief The `BodyPart`s each `Joint` is derived from, indexed by `Joint`
+ *
+ * This is the only place body parts are mapped onto joints. Body parts that
+ * are not listed are not decoded from the model's output at all.
+ *
+ */
+constexpr JointBodyParts joint_body_parts[JointMax + 1] = {
+    {{head_top}, 1},                       // Head
+    {{upper_neck}, 1},                     // Neck
+    {{left_shoulder, right_shoulder}, 2},  // Shoulder
+    {{left_hip, right_hip, pelvis}, 3},    // Hip
+    {{left_knee, right_knee}, 2},          // Knee
+    {{left_ankle, right_ankle}, 2},        // Foot
+};
+
+/**
+ * @brief Bit mask of the `BodyPart`s used by `joint_body_parts` from `joint`
+ * onwards, starting at its `i`th body part
+ *
+ */
+constexpr uint32_t body_part_mask(int joint = JointMin, size_t i = 0) {
+  return joint > JointMax ? 0
+         : i == joint_body_parts[joint].count
+             ? body_part_mask(joint + 1, 0)
+             : (1u << joint_body_parts[joint].body_parts[i]) |
+                   body_part_mask(joint, i + 1);
+}
+
+/**
+ * @brief Bit mask of the `BodyPart`s that any `Joint` is derived from
+ *
+ */
+constexpr uint32_t USED_BODY_PARTS = body_part_mask();
+
+/**
+ * @brief Whether any `Joint` is derived from `body_part`
+ *
+ */
+constexpr bool body_part_used(int body_part) {
+  return (USED_BODY_PARTS >> body_part) & 1;
+}
+
+/**
+ * @brief Type of the elements of one of the model's input or output tensors
+ *
+ */
+enum TensorType {
+  Float32Tensor,
+  UInt8Tensor,  ///< Quantised, see `Quantisation`
+  Int8Tensor,   ///< Quantised, see `Quantisation`
+};
+
+/**
+ * @brief Maps the integers `q` of a quantised tensor onto the real values
+ * `scale * (q - zero_point)`
+ *
+ */
+struct Quantisation {
+  float scale;
+  int32_t zero_point;
+};
+
 namespace PreProcessing {
 /**
  * @brief A structure of the pre processed image
@@ -81,14 +161,39 @@ namespace PreProcessing {
  * After pre processing, the image will be resized and normalised before
  * being passed to the `Inference::InferenceCore` as a `PreProcessedImage`
  *
+ * This is only a view: the memory is owned elsewhere, normally by the
+ * interpreter as its input tensor, so that the image is never copied.
+ *
  */
 struct PreProcessedImage {
   /**
    * @brief The image array where each pixel is represented by the 3 RGB
-   * channels
+   * channels, if `type` is `Float32Tensor`
    *
    */
   float* image;
+
+  /**
+   * @brief As `image`, with each channel a `uint8_t` or `int8_t` quantised
+   * with `quantisation`, if `type` is `UInt8Tensor` or `Int8Tensor`
+   *
+   */
+  uint8_t* quantised;
+  TensorType type;            ///< `Float32Tensor` if not given
+  Quantisation quantisation;  ///< Of `quantised`
+};
+
+/**
+ * @brief A rectangle within a frame, in *relative* co-ordinates
+ *
+ * `Region{0, 0, 1, 1}` is the whole frame.
+ *
+ */
+struct Region {
+  float x;       ///< The *relative* X co-ordinate of the left edge
+  float y;       ///< The *relative* Y co-ordinate of the top edge
+  float width;   ///< The *relative* width
+  float height;  ///< The *relative* height
 };
 }  // namespace PreProcessing
 
@@ -17,18 +17,29 @@
  *
  */
 
+#include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 
 #include <QApplication>
+#include <memory>
+#include <stdexcept>
 
+#include "frame_source.h"
 #include "gui/mainwindow.h"
 #include "intermediate_structures.h"
+#include "metrics.h"
 #include "pipeline.h"
 #include "post_processor.h"
 #include "posture_estimator.h"
+#include "trace.h"
+#ifdef __linux__
+#include "v4l2_source.h"
+#endif
 
 #define NUM_LOOPS 500
 #define NUM_INF_CORE_THREADS 8
+#define NUM_THREADS_PER_INF_CORE 1
 
 bool run_flag = true;
 
@@ -38,12 +49,71 @@ Pipeline::Pipeline* pipeline_ptr;
 void frame_callback(PostureEstimating::PoseStatus pose_status,
                     cv::Mat input_image) {
   main_window_ptr->updatePose(pose_status);
-  main_window_ptr->emitNewFrame(input_image);
+  main_window_ptr->emitNewFrame(input_image, Trace::frame());
+}
+
+/**
+ * @brief Open the camera, without copying frames where the platform allows
+ *
+ */
+std::unique_ptr<FrameSource::FrameSource> open_camera(void) {
+#ifdef __linux__
+  try {
+    return std::unique_ptr<FrameSource::FrameSource>(
+        new FrameSource::V4L2Source("/dev/video0"));
+  } catch (const std::runtime_error& e) {
+    fprintf(stderr, "%s, falling back on OpenCV capture\n", e.what());
+  }
+#endif
+  return std::unique_ptr<FrameSource::FrameSource>(new FrameSource::Camera(0));
 }
 
 int main(int argc, char* argv[]) {
   printf("start\n");
-  Pipeline::Pipeline p(NUM_INF_CORE_THREADS, &frame_callback);
+  // Record a trace of every frame if asked to, see `trace.h`
+  const char* trace_path = getenv("POSTURE_TRACE");
+  if (trace_path != NULL) {
+#ifdef ENABLE_TRACING
+    Trace::start(trace_path);
+#else
+    fprintf(stderr, "POSTURE_TRACE ignored: build with ENABLE_TRACING\n");
+#endif
+  }
+
+  // Periodically write aggregated metrics if asked to, see `metrics.h`.
+  // Declared before the pipeline so the final snapshot covers all of it
+  std::unique_ptr<Metrics::Dumper> metrics_dumper;
+  const char* metrics_destination = getenv("POSTURE_METRICS");
+  if (metrics_destination != NULL) {
+    metrics_dumper.reset(new Metrics::Dumper(metrics_destination));
+  }
+
+  // Trade inference core threads for threads per core, e.g. "1x4" for the
+  // lowest latency at low frame rates
+  unsigned int num_cores = NUM_INF_CORE_THREADS;
+  unsigned int threads_per_core = NUM_THREADS_PER_INF_CORE;
+  const char* inference_threads = getenv("POSTURE_INFERENCE_THREADS");
+  // Both are passed to the pipeline as `uint8_t`s, which must not be zero
+  if (inference_threads != NULL &&
+      (sscanf(inference_threads, "%ux%u", &num_cores, &threads_per_core) != 2 ||
+       num_cores < 1 || num_cores > UINT8_MAX || threads_per_core < 1 ||
+       threads_per_core > UINT8_MAX)) {
+    fprintf(stderr,
+            "POSTURE_INFERENCE_THREADS must look like 8x1, with both numbers "
+            "from 1 to 255\n");
+    return EXIT_FAILURE;
+  }
+
+  // The GUI only cares about the freshest pose, so never stall capture, and
+  // only decode the frames that are actually used
+  Pipeline::Pipeline p(num_cores, &frame_callback, open_camera(),
+                       Buffer::KeepLatest, Pipeline::DecodeOnDemand,
+                       threads_per_core);
+  // Step down to cheaper variants of the model whenever the inference cores
+  // cannot keep up with the frame rate, see `QoS::Governor`
+  if (getenv("POSTURE_QOS") != NULL) {
+    p.set_qos_governor(true);
+  }
   pipeline_ptr = &p;
   QApplication a(argc, argv);
   GUI::MainWindow w(pipeline_ptr);
@@ -51,5 +121,7 @@ int main(int argc, char* argv[]) {
   w.show();
 
   main_window_ptr = &w;
-  return a.exec();
+  int exit_code = a.exec();
+  Trace::stop();
+  return exit_code;
 }
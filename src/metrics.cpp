@@ -0,0 +1,246 @@
+/**
+ * @copyright Copyright (C) 2021  Miklas Riechmann
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "metrics.h"
+
+#include <inttypes.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace Metrics {
+
+Histogram::Histogram(void) {
+  for (auto& bucket : buckets) {
+    bucket = 0;
+  }
+}
+
+size_t Histogram::bucket_of(uint64_t value) {
+  if (value < HISTOGRAM_SUB_BUCKETS) {
+    return value;
+  }
+  // Position of the highest set bit, at least `HISTOGRAM_SUB_BUCKET_BITS`
+  int exponent = 63 - __builtin_clzll(value);
+  int shift = exponent - HISTOGRAM_SUB_BUCKET_BITS;
+  size_t sub_bucket = (value >> shift) - HISTOGRAM_SUB_BUCKETS;
+  return (shift + 1) * HISTOGRAM_SUB_BUCKETS + sub_bucket;
+}
+
+uint64_t Histogram::upper_bound_of(size_t bucket) {
+  if (bucket < HISTOGRAM_SUB_BUCKETS) {
+    return bucket;
+  }
+  int shift = bucket / HISTOGRAM_SUB_BUCKETS - 1;
+  uint64_t sub_bucket = bucket % HISTOGRAM_SUB_BUCKETS;
+  uint64_t lower = (HISTOGRAM_SUB_BUCKETS + sub_bucket) << shift;
+  return lower + ((1ULL << shift) - 1);
+}
+
+void Histogram::record(uint64_t value) {
+  buckets[bucket_of(value)].fetch_add(1, std::memory_order_relaxed);
+  count.fetch_add(1, std::memory_order_relaxed);
+  sum.fetch_add(value, std::memory_order_relaxed);
+
+  uint64_t current = max.load(std::memory_order_relaxed);
+  while (value > current && !max.compare_exchange_weak(
+                                current, value, std::memory_order_relaxed)) {
+  }
+}
+
+double Histogram::get_mean(void) {
+  uint64_t n = count.load();
+  return n == 0 ? 0 : static_cast<double>(sum.load()) / n;
+}
+
+uint64_t Histogram::get_percentile(double percentile) {
+  uint64_t n = count.load();
+  if (n == 0) {
+    return 0;
+  }
+  uint64_t target = ceil(percentile / 100.0 * n);
+  if (target == 0) {
+    target = 1;
+  }
+
+  uint64_t seen = 0;
+  for (size_t bucket = 0; bucket < NUM_BUCKETS; bucket++) {
+    seen += buckets[bucket].load();
+    if (seen >= target) {
+      uint64_t upper_bound = upper_bound_of(bucket);
+      uint64_t largest = max.load();
+      return upper_bound < largest ? upper_bound : largest;
+    }
+  }
+  // Only reached if values were recorded while counting
+  return max.load();
+}
+
+/**
+ * @brief All metrics by name
+ *
+ * Metrics are never removed, so references to them stay valid
+ *
+ */
+template <typename M>
+class Registry {
+ private:
+  std::mutex mutex;
+  std::map<std::string, std::unique_ptr<M>> metrics;
+
+ public:
+  M& get(std::string name) {
+    std::unique_lock<std::mutex> lock(mutex);
+    auto& metric = metrics[name];
+    if (!metric) {
+      metric.reset(new M());
+    }
+    return *metric;
+  }
+
+  /**
+   * @brief Call `f(name, metric)` for every metric, in order of name
+   *
+   */
+  template <typename F>
+  void for_each(F f) {
+    std::unique_lock<std::mutex> lock(mutex);
+    for (auto& metric : metrics) {
+      f(metric.first, *metric.second);
+    }
+  }
+};
+
+static Registry<Counter> counters;
+static Registry<Gauge> gauges;
+static Registry<Histogram> histograms;
+
+Counter& counter(std::string name) { return counters.get(name); }
+Gauge& gauge(std::string name) { return gauges.get(name); }
+Histogram& histogram(std::string name) { return histograms.get(name); }
+
+std::string snapshot(void) {
+  std::string json = "{\"timestamp_ms\":";
+  char number[64];
+  snprintf(number, sizeof(number), "%" PRId64,
+           static_cast<int64_t>(
+               std::chrono::duration_cast<std::chrono::milliseconds>(
+                   std::chrono::system_clock::now().time_since_epoch())
+                   .count()));
+  json += number;
+
+  const char* separator = "";
+  json += ",\"counters\":{";
+  counters.for_each([&](const std::string& name, Counter& metric) {
+    snprintf(number, sizeof(number), "%" PRIu64, metric.get());
+    json += separator + ("\"" + name + "\":") + number;
+    separator = ",";
+  });
+
+  separator = "";
+  json += "},\"gauges\":{";
+  gauges.for_each([&](const std::string& name, Gauge& metric) {
+    snprintf(number, sizeof(number), "%g", metric.get());
+    json += separator + ("\"" + name + "\":") + number;
+    separator = ",";
+  });
+
+  separator = "";
+  json += "},\"histograms\":{";
+  histograms.for_each([&](const std::string& name, Histogram& metric) {
+    char summary[256];
+    snprintf(summary, sizeof(summary),
+             "{\"count\":%" PRIu64 ",\"mean\":%.1f,\"p50\":%" PRIu64
+             ",\"p90\":%" PRIu64 ",\"p99\":%" PRIu64 ",\"max\":%" PRIu64 "}",
+             metric.get_count(), metric.get_mean(), metric.get_percentile(50),
+             metric.get_percentile(90), metric.get_percentile(99),
+             metric.get_max());
+    json += separator + ("\"" + name + "\":") + summary;
+    separator = ",";
+  });
+  json += "}}\n";
+  return json;
+}
+
+Dumper::Dumper(std::string destination, size_t period_ms)
+    : destination(destination), period(period_ms) {
+  std::thread t(&Dumper::thread_body, this);
+  thread = std::move(t);
+}
+
+Dumper::~Dumper() {
+  std::unique_lock<std::mutex> lock(mutex);
+  running = false;
+  cv.notify_one();
+  lock.unlock();
+  thread.join();
+  dump();
+}
+
+void Dumper::thread_body(void) {
+  std::unique_lock<std::mutex> lock(mutex);
+  while (running) {
+    if (cv.wait_for(lock, period, [this] { return !running; })) {
+      break;
+    }
+    lock.unlock();
+    dump();
+    lock.lock();
+  }
+}
+
+bool Dumper::dump(void) {
+  std::string json = snapshot();
+
+  const std::string socket_prefix = "unix:";
+  if (destination.compare(0, socket_prefix.size(), socket_prefix) == 0) {
+    std::string path = destination.substr(socket_prefix.size());
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+      return false;
+    }
+    bool sent = connect(fd, reinterpret_cast<sockaddr*>(&address),
+                        sizeof(address)) == 0 &&
+                send(fd, json.data(), json.size(), MSG_NOSIGNAL) ==
+                    static_cast<ssize_t>(json.size());
+    close(fd);
+    return sent;
+  }
+
+  // Write to a temporary file and rename it, so the snapshot is replaced
+  // atomically
+  std::string temporary = destination + ".tmp";
+  FILE* file = fopen(temporary.c_str(), "w");
+  if (file == NULL) {
+    fprintf(stderr, "Cannot write metrics to %s\n", temporary.c_str());
+    return false;
+  }
+  bool written = fwrite(json.data(), 1, json.size(), file) == json.size();
+  written = fclose(file) == 0 && written;
+  return written && rename(temporary.c_str(), destination.c_str()) == 0;
+}
+
+}  // namespace Metrics
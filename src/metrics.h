@@ -0,0 +1,210 @@
+/**
+ * @file metrics.h
+ * @brief Counters, gauges and latency histograms describing how the pipeline
+ * performs over time
+ *
+ * @copyright Copyright (C) 2021  Miklas Riechmann
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef SRC_METRICS_H_
+#define SRC_METRICS_H_
+
+#include <stdint.h>
+
+#include <atomic>
+#include <chrono>              //NOLINT [build/c++11]
+#include <condition_variable>  //NOLINT [build/c++11]
+#include <map>
+#include <memory>
+#include <mutex>  //NOLINT [build/c++11]
+#include <string>
+#include <thread>  //NOLINT [build/c++11]
+
+/**
+ * @brief Number of histogram buckets per power of two
+ *
+ * Bounds the error of a percentile to 1/16th of its value
+ *
+ */
+#define HISTOGRAM_SUB_BUCKETS 16
+#define HISTOGRAM_SUB_BUCKET_BITS 4  ///< log2(`HISTOGRAM_SUB_BUCKETS`)
+
+#define METRICS_DUMP_PERIOD 10000  ///< Default time between snapshots in ms
+
+/**
+ * @brief Aggregated measurements of the pipeline, such as latency percentiles
+ * and frame rates
+ *
+ * Unlike `Trace`, which records every single frame, metrics are cheap enough
+ * to be always on. Metrics are created by name through `Metrics::counter()`,
+ * `Metrics::gauge()` and `Metrics::histogram()`, which always return the same
+ * object for the same name. Updating a metric is lock-free, so the hot paths
+ * should look a metric up once and keep the reference.
+ *
+ * A `Metrics::Dumper` periodically writes a JSON snapshot of all metrics.
+ *
+ */
+namespace Metrics {
+
+/**
+ * @brief A number that only ever goes up, e.g. the number of frames processed
+ *
+ */
+class Counter {
+ private:
+  std::atomic<uint64_t> value{0};
+
+ public:
+  void add(uint64_t n = 1) { value.fetch_add(n, std::memory_order_relaxed); }
+  uint64_t get(void) { return value.load(std::memory_order_relaxed); }
+};
+
+/**
+ * @brief A number that is set to its current value, e.g. a queue depth
+ *
+ */
+class Gauge {
+ private:
+  std::atomic<double> value{0};
+
+ public:
+  void set(double new_value) {
+    value.store(new_value, std::memory_order_relaxed);
+  }
+  double get(void) { return value.load(std::memory_order_relaxed); }
+};
+
+/**
+ * @brief Distribution of values, e.g. latencies in µs
+ *
+ * Values are counted in buckets that grow exponentially, with
+ * `HISTOGRAM_SUB_BUCKETS` buckets for every power of two like an HDR
+ * histogram. Recording is a single atomic increment, and any percentile is
+ * accurate to within 1/16th of its value.
+ *
+ */
+class Histogram {
+ private:
+  static const size_t NUM_BUCKETS =
+      (64 - HISTOGRAM_SUB_BUCKET_BITS + 1) * HISTOGRAM_SUB_BUCKETS;
+
+  std::atomic<uint64_t> buckets[NUM_BUCKETS];
+  std::atomic<uint64_t> count{0};
+  std::atomic<uint64_t> sum{0};
+  std::atomic<uint64_t> max{0};
+
+  static size_t bucket_of(uint64_t value);
+
+  /**
+   * @brief Largest value that falls into `bucket`
+   *
+   */
+  static uint64_t upper_bound_of(size_t bucket);
+
+ public:
+  Histogram(void);
+
+  void record(uint64_t value);
+
+  /**
+   * @brief Record the time since `start` in µs
+   *
+   */
+  void record_since(std::chrono::steady_clock::time_point start) {
+    record(std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now() - start)
+               .count());
+  }
+
+  uint64_t get_count(void) { return count.load(); }
+  uint64_t get_max(void) { return max.load(); }
+  double get_mean(void);
+
+  /**
+   * @brief Get a percentile of the values recorded
+   *
+   * @param percentile Percentile in the range [0..100]
+   * @return `uint64_t` The upper bound of the bucket holding the percentile,
+   * capped at the largest value recorded. Zero if nothing was recorded
+   */
+  uint64_t get_percentile(double percentile);
+};
+
+Counter& counter(std::string name);
+Gauge& gauge(std::string name);
+Histogram& histogram(std::string name);
+
+/**
+ * @brief Get the current value of every metric
+ *
+ * Histograms are summarised by their count, mean, p50, p90, p99 and maximum.
+ *
+ * @return `std::string` JSON object
+ */
+std::string snapshot(void);
+
+/**
+ * @brief Periodically writes a `snapshot()` of all metrics in the background
+ *
+ */
+class Dumper {
+ private:
+  /**
+   * @brief File path, or `unix:` followed by the path of a Unix socket
+   *
+   */
+  std::string destination;
+  std::chrono::milliseconds period;
+
+  std::mutex mutex;
+  std::condition_variable cv;
+  bool running = true;
+  std::thread thread;
+
+  void thread_body(void);
+
+  /**
+   * @brief Write a snapshot to the destination
+   *
+   * A file is replaced as a whole, so readers never see a partial snapshot. A
+   * socket is sent one snapshot per connection.
+   *
+   * @return `true` If the snapshot was written
+   */
+  bool dump(void);
+
+ public:
+  /**
+   * @brief Start writing snapshots
+   *
+   * @param destination File to write to, or `unix:` followed by the path of a
+   * listening Unix stream socket to send to
+   * @param period_ms Time between snapshots in ms
+   */
+  explicit Dumper(std::string destination,
+                  size_t period_ms = METRICS_DUMP_PERIOD);
+
+  /**
+   * @brief Write a final snapshot and stop
+   *
+   */
+  ~Dumper();
+};
+
+}  // namespace Metrics
+
+#endif  // SRC_METRICS_H_
@@ -0,0 +1,243 @@
+/**
+ * @copyright Copyright (C) 2021  Miklas Riechmann
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "normalise.h"
+
+#include <math.h>
+
+#include <stdexcept>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define NORMALISE_X86
+#include <immintrin.h>
+#elif defined(__aarch64__)
+// 32-bit NEON has no IEEE division, so cannot match the scalar output
+#define NORMALISE_NEON
+#include <arm_neon.h>
+#endif
+
+#define NORMALISE_OFFSET 127.5f
+#define NORMALISE_SCALE 127.5f
+
+namespace PreProcessing {
+
+/**
+ * @brief Normalise a single pixel, swapping B and R
+ *
+ */
+static inline void normalise_pixel(const uint8_t* bgr, float* rgb) {
+  rgb[0] = (bgr[2] - NORMALISE_OFFSET) / NORMALISE_SCALE;
+  rgb[1] = (bgr[1] - NORMALISE_OFFSET) / NORMALISE_SCALE;
+  rgb[2] = (bgr[0] - NORMALISE_OFFSET) / NORMALISE_SCALE;
+}
+
+static void normalise_scalar(const uint8_t* bgr, float* rgb,
+                             size_t num_pixels) {
+  for (size_t i = 0; i < num_pixels; i++) {
+    normalise_pixel(&bgr[i * 3], &rgb[i * 3]);
+  }
+}
+
+#ifdef NORMALISE_X86
+/**
+ * @brief Reverse the channels of 4 BGR pixels in the lower 12 bytes
+ *
+ */
+__attribute__((target("sse4.1"))) static inline __m128i swap_channels(
+    __m128i bgr) {
+  const __m128i mask =
+      _mm_setr_epi8(2, 1, 0, 5, 4, 3, 8, 7, 6, 11, 10, 9, -1, -1, -1, -1);
+  return _mm_shuffle_epi8(bgr, mask);
+}
+
+__attribute__((target("sse4.1"))) static void normalise_sse41(
+    const uint8_t* bgr, float* rgb, size_t num_pixels) {
+  const __m128 offset = _mm_set1_ps(NORMALISE_OFFSET);
+  const __m128 scale = _mm_set1_ps(NORMALISE_SCALE);
+
+  size_t i = 0;
+  // Each 16 byte load reads 4 pixels plus 4 bytes beyond them
+  for (; i + 6 <= num_pixels; i += 4) {
+    __m128i pixels = swap_channels(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(&bgr[i * 3])));
+    for (int part = 0; part < 3; part++) {
+      __m128 values = _mm_cvtepi32_ps(_mm_cvtepu8_epi32(pixels));
+      _mm_storeu_ps(&rgb[i * 3 + part * 4],
+                    _mm_div_ps(_mm_sub_ps(values, offset), scale));
+      pixels = _mm_srli_si128(pixels, 4);
+    }
+  }
+  normalise_scalar(&bgr[i * 3], &rgb[i * 3], num_pixels - i);
+}
+
+__attribute__((target("avx2"))) static void normalise_avx2(
+    const uint8_t* bgr, float* rgb, size_t num_pixels) {
+  const __m256 offset = _mm256_set1_ps(NORMALISE_OFFSET);
+  const __m256 scale = _mm256_set1_ps(NORMALISE_SCALE);
+
+  size_t i = 0;
+  // The second 16 byte load reads 4 bytes beyond the 8 pixels
+  for (; i + 10 <= num_pixels; i += 8) {
+    __m128i low = swap_channels(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(&bgr[i * 3])));
+    __m128i high = swap_channels(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(&bgr[i * 3 + 12])));
+
+    // The 24 swapped bytes, 8 at a time
+    __m128i parts[3] = {
+        low, _mm_unpacklo_epi32(_mm_srli_si128(low, 8), high),
+        _mm_srli_si128(high, 4)};
+    for (int part = 0; part < 3; part++) {
+      __m256 values = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(parts[part]));
+      _mm256_storeu_ps(&rgb[i * 3 + part * 8],
+                       _mm256_div_ps(_mm256_sub_ps(values, offset), scale));
+    }
+  }
+  normalise_scalar(&bgr[i * 3], &rgb[i * 3], num_pixels - i);
+}
+#endif
+
+#ifdef NORMALISE_NEON
+static inline void normalise_neon_quarter(uint8x16_t values, int quarter,
+                                          float32x4_t offset, float32x4_t scale,
+                                          float32x4_t* out) {
+  uint16x8_t half = quarter < 2 ? vmovl_u8(vget_low_u8(values))
+                                : vmovl_u8(vget_high_u8(values));
+  uint32x4_t words = quarter % 2 == 0 ? vmovl_u16(vget_low_u16(half))
+                                      : vmovl_u16(vget_high_u16(half));
+  *out = vdivq_f32(vsubq_f32(vcvtq_f32_u32(words), offset), scale);
+}
+
+static void normalise_neon(const uint8_t* bgr, float* rgb,
+                           size_t num_pixels) {
+  const float32x4_t offset = vdupq_n_f32(NORMALISE_OFFSET);
+  const float32x4_t scale = vdupq_n_f32(NORMALISE_SCALE);
+
+  size_t i = 0;
+  for (; i + 16 <= num_pixels; i += 16) {
+    // Loads the B, G and R channels of 16 pixels into separate registers
+    uint8x16x3_t channels = vld3q_u8(&bgr[i * 3]);
+    for (int quarter = 0; quarter < 4; quarter++) {
+      float32x4x3_t out;
+      normalise_neon_quarter(channels.val[2], quarter, offset, scale,
+                             &out.val[0]);
+      normalise_neon_quarter(channels.val[1], quarter, offset, scale,
+                             &out.val[1]);
+      normalise_neon_quarter(channels.val[0], quarter, offset, scale,
+                             &out.val[2]);
+      vst3q_f32(&rgb[(i + quarter * 4) * 3], out);
+    }
+  }
+  normalise_scalar(&bgr[i * 3], &rgb[i * 3], num_pixels - i);
+}
+#endif
+
+bool normalise_supported(NormaliseKernel kernel) {
+  switch (kernel) {
+    case NormaliseScalar:
+      return true;
+#ifdef NORMALISE_X86
+    case NormaliseSSE41:
+      return __builtin_cpu_supports("sse4.1");
+    case NormaliseAVX2:
+      return __builtin_cpu_supports("avx2");
+#endif
+#ifdef NORMALISE_NEON
+    case NormaliseNEON:
+      return true;
+#endif
+    default:
+      return false;
+  }
+}
+
+NormaliseKernel normalise_best_kernel(void) {
+  static const NormaliseKernel best = [] {
+    NormaliseKernel fastest_first[] = {NormaliseAVX2, NormaliseSSE41,
+                                       NormaliseNEON};
+    for (auto kernel : fastest_first) {
+      if (normalise_supported(kernel)) {
+        return kernel;
+      }
+    }
+    return NormaliseScalar;
+  }();
+  return best;
+}
+
+void normalise(NormaliseKernel kernel, const uint8_t* bgr, float* rgb,
+               size_t num_pixels) {
+  switch (kernel) {
+    case NormaliseScalar:
+      normalise_scalar(bgr, rgb, num_pixels);
+      return;
+#ifdef NORMALISE_X86
+    case NormaliseSSE41:
+      normalise_sse41(bgr, rgb, num_pixels);
+      return;
+    case NormaliseAVX2:
+      normalise_avx2(bgr, rgb, num_pixels);
+      return;
+#endif
+#ifdef NORMALISE_NEON
+    case NormaliseNEON:
+      normalise_neon(bgr, rgb, num_pixels);
+      return;
+#endif
+    default:
+      throw std::invalid_argument("Normalise kernel not supported");
+  }
+}
+
+void normalise(const uint8_t* bgr, float* rgb, size_t num_pixels) {
+  normalise(normalise_best_kernel(), bgr, rgb, num_pixels);
+}
+
+void quantise_table(TensorType type, Quantisation quantisation,
+                    uint8_t table[256]) {
+  int32_t min;
+  int32_t max;
+  if (type == UInt8Tensor) {
+    min = 0;
+    max = 255;
+  } else if (type == Int8Tensor) {
+    min = -128;
+    max = 127;
+  } else {
+    throw std::invalid_argument("Can only quantise to 8 bit integers");
+  }
+
+  for (int value = 0; value < 256; value++) {
+    float normalised = (value - NORMALISE_OFFSET) / NORMALISE_SCALE;
+    int32_t q = static_cast<int32_t>(lrintf(normalised / quantisation.scale)) +
+                quantisation.zero_point;
+    q = q < min ? min : (q > max ? max : q);
+    table[value] = static_cast<uint8_t>(q);
+  }
+}
+
+void quantise(const uint8_t table[256], const uint8_t* bgr, uint8_t* rgb,
+              size_t num_pixels) {
+  for (size_t i = 0; i < num_pixels * 3; i += 3) {
+    rgb[i + 0] = table[bgr[i + 2]];
+    rgb[i + 1] = table[bgr[i + 1]];
+    rgb[i + 2] = table[bgr[i + 0]];
+  }
+}
+
+}  // namespace PreProcessing
@@ -0,0 +1,109 @@
+/**
+ * @file normalise.h
+ * @brief Vectorised conversion of BGR pixels to the model's normalised RGB
+ * input
+ *
+ * @copyright Copyright (C) 2021  Miklas Riechmann
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef SRC_NORMALISE_H_
+#define SRC_NORMALISE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "intermediate_structures.h"
+
+namespace PreProcessing {
+
+/**
+ * @brief Implementations of `normalise()`
+ *
+ * All kernels produce bit-identical output: each channel is computed as
+ * `(value - 127.5f) / 127.5f`, which is exactly the float nearest to
+ * `value / 127.5 - 1`. Multiplying by the reciprocal instead would be faster
+ * but differs in the last bit for most values.
+ *
+ */
+enum NormaliseKernel {
+  NormaliseScalar,
+  NormaliseSSE41,  ///< x86 with SSE4.1, 4 pixels at a time
+  NormaliseAVX2,   ///< x86 with AVX2, 8 pixels at a time
+  NormaliseNEON,   ///< 64-bit ARM, 4 pixels at a time
+};
+
+/**
+ * @brief Check if `kernel` can run on this CPU
+ *
+ */
+bool normalise_supported(NormaliseKernel kernel);
+
+/**
+ * @brief The fastest kernel this CPU supports, detected once at run time
+ *
+ */
+NormaliseKernel normalise_best_kernel(void);
+
+/**
+ * @brief Convert BGR pixels to RGB and scale them to [-1..1]
+ *
+ * @param kernel Implementation to use, must be supported
+ * @param bgr `num_pixels` pixels with 3 interleaved channels
+ * @param rgb Output for `num_pixels * 3` floats
+ * @param num_pixels Number of pixels to convert
+ */
+void normalise(NormaliseKernel kernel, const uint8_t* bgr, float* rgb,
+               size_t num_pixels);
+
+/**
+ * @brief Convert BGR pixels to RGB and scale them to [-1..1], using the
+ * fastest kernel
+ *
+ */
+void normalise(const uint8_t* bgr, float* rgb, size_t num_pixels);
+
+/**
+ * @brief Build the table `quantise()` uses to convert each channel value to
+ * a quantised model's input
+ *
+ * Each value is normalised as by `normalise()`, then quantised to the nearest
+ * integer of `type` and saturated. Only needs to be rebuilt if the model
+ * changes, so the conversion itself needs no floating point arithmetic.
+ *
+ * @param type `UInt8Tensor` or `Int8Tensor`
+ * @param quantisation Of the model's input
+ * @param table Output for a value per channel value, `int8_t`s are stored as
+ * their bits
+ * @throw `std::invalid_argument` if `type` is not quantised
+ */
+void quantise_table(TensorType type, Quantisation quantisation,
+                    uint8_t table[256]);
+
+/**
+ * @brief Convert BGR pixels to RGB and quantise them
+ *
+ * @param table Built by `quantise_table()`
+ * @param bgr `num_pixels` pixels with 3 interleaved channels
+ * @param rgb Output for `num_pixels * 3` quantised channels
+ * @param num_pixels Number of pixels to convert
+ */
+void quantise(const uint8_t table[256], const uint8_t* bgr, uint8_t* rgb,
+              size_t num_pixels);
+
+}  // namespace PreProcessing
+
+#endif  // SRC_NORMALISE_H_
@@ -18,28 +18,50 @@
 
 #include "pipeline.h"
 
+#include <inttypes.h>
+
+#include <chrono>  //NOLINT [build/c++11]
 #include <exception>
 #include <string>
 #include <utility>
+#include <vector>
 
+#define MODEL_FILENAME "assets/EfficientPoseRT_LITE.tflite"
 #define MODEL_INPUT_X 224
 #define MODEL_INPUT_Y 224
 #define CONFIDENCE_THRESH_DEFAULT 0.1
+#define SUBPIXEL_REFINEMENT Inference::QuadraticRefinement
+#define FPS_WINDOW 1000  ///< Minimum time in ms to measure the frame rate over
 
 namespace Pipeline {
 
-FrameGenerator::FrameGenerator(void) : cap(0) {
-  if (!cap.isOpened()) {
-    throw std::runtime_error("Cannot access camera");
-  }
+/**
+ * @brief The variants of the model the `QoS::Governor` switches between
+ *
+ * Only one model is shipped, so the variants run it at lower resolutions. It
+ * is fully convolutional, so its cost is proportional to the number of pixels.
+ *
+ */
+static std::vector<QoS::Variant> model_variants(void) {
+  return std::vector<QoS::Variant>{
+      QoS::Variant{MODEL_FILENAME, MODEL_INPUT_X, MODEL_INPUT_Y,
+                   MODEL_INPUT_X * MODEL_INPUT_Y},
+      QoS::Variant{MODEL_FILENAME, 192, 192, 192 * 192},
+      QoS::Variant{MODEL_FILENAME, 160, 160, 160 * 160},
+      QoS::Variant{MODEL_FILENAME, 128, 128, 128 * 128},
+  };
+}
+
+FrameGenerator::FrameGenerator(
+    std::unique_ptr<FrameSource::FrameSource> source, CaptureMode capture_mode)
+    : source(std::move(source)), capture_mode(capture_mode) {
   // Ensure there is always a frame ready
   cv::Mat frame;
-  cap.read(frame);
-  if (frame.empty()) {
-    fprintf(stderr, "Empty frame from camera\n");
-    return;
+  if (!this->source->read(&frame) || frame.empty()) {
+    throw std::runtime_error("Cannot read from frame source");
   }
-  current_frame = frame;
+  current_frame.publish(CapturedFrame{frame, Trace::Clock::time_point(),
+                                      Trace::Clock::time_point(), 0});
 
   // Start thread that continuously gets newest frame
   std::thread t(&FrameGenerator::FrameGenerator::thread_body, this);
@@ -56,91 +78,368 @@ void FrameGenerator::updated_framerate(size_t new_frame_delay) {
   startms(new_frame_delay);
 }
 
-void FrameGenerator::timerEvent(void) { cv.notify_one(); }
+void FrameGenerator::timerEvent(void) {
+  if (capture_mode == DecodeOnDemand) {
+    // The capture thread releases the frame once it has decoded it
+    frame_requested = true;
+    return;
+  }
+  release_frame();
+}
+
+void FrameGenerator::release_frame(void) {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    frame_released = true;
+  }
+  cv.notify_one();
+}
 
 void FrameGenerator::thread_body(void) {
+  TRACE_THREAD_NAME("Capture");
+  uint32_t tid = Trace::thread_id();
   while (running) {
-    cv::Mat frame;
-    cap.read(frame);
+    auto grabbed = TRACE_NOW();
+    if (!source->grab()) {
+      fprintf(stderr, "Empty frame\n");
+      continue;
+    }
 
-    if (frame.empty()) {
+    // Nobody needs this frame, so skip decoding it. The request is consumed
+    // here so that a tick arriving while decoding is kept for the next frame
+    if (capture_mode == DecodeOnDemand && !frame_requested.exchange(false)) {
+      continue;
+    }
+
+    cv::Mat frame;
+    if (!source->retrieve(&frame) || frame.empty()) {
       fprintf(stderr, "Empty frame\n");
+      if (capture_mode == DecodeOnDemand) {
+        // Still owed a frame
+        frame_requested = true;
+      }
       continue;
     }
 
-    std::unique_lock<std::mutex> lock(mutex);
-    current_frame = frame;
-    lock.unlock();
+    current_frame.publish(CapturedFrame{frame, grabbed, TRACE_NOW(), tid});
+    if (capture_mode == DecodeOnDemand) {
+      release_frame();
+    }
   }
 }
 
+FrameSource::PixelFormat FrameGenerator::pixel_format(void) {
+  return source->pixel_format();
+}
+
 RawFrame FrameGenerator::next_frame(void) {
   // Lock so only a single thread can get next frame at once
   std::unique_lock<std::mutex> lock(mutex);
-  cv.wait(lock);
-  auto output = RawFrame{id++, current_frame};
+  cv.wait(lock, [this] { return frame_released; });
+  frame_released = false;
+  auto frame = current_frame.read();
+  auto output = RawFrame{id++, frame.image, std::chrono::steady_clock::now()};
   lock.unlock();
+
+  TRACE_COMPLETE("Capture", output.id, frame.grabbed, frame.retrieved,
+                 frame.tid);
   return output;
 }
 
 void Pipeline::core_thread_body(Inference::InferenceCore core) {
+  TRACE_THREAD_NAME("Inference core");
+  std::vector<RawFrame> frames;
+  std::vector<PreProcessing::Region> regions;
+  // The last `input_generation` tried, so a failed switch is not retried for
+  // every batch, and the one the core actually runs at
+  uint64_t generation = 0;
+  uint64_t running_generation = 0;
+  std::shared_ptr<PreProcessing::PreProcessor> core_preprocessor;
+  {
+    std::lock_guard<std::mutex> lock(input_mutex);
+    core_preprocessor = preprocessor;
+  }
   while (running) {
-    auto raw_next_frame = frame_generator.next_frame();
-    auto preprocessed_image = preprocessor.run(raw_next_frame.raw_image);
+    // Switch model or resolution between batches, when no frames are held
+    if (input_generation != generation) {
+      cv::Size size;
+      std::shared_ptr<const Inference::Model> model;
+      {
+        std::lock_guard<std::mutex> lock(input_mutex);
+        generation = input_generation;
+        size = input_size;
+        model = input_model;
+        core_preprocessor = preprocessor;
+      }
+      try {
+        if (model != core.get_model()) {
+          core.set_model(model, size.width, size.height);
+        } else {
+          core.resize_input(size.width, size.height);
+        }
+        running_generation = generation;
+      } catch (const std::exception& e) {
+        // The core carries on with its previous model and resolution, so pre
+        // process to match it
+        fprintf(stderr, "%s\n", e.what());
+        core_preprocessor.reset(new PreProcessing::PreProcessor(
+            core.get_input_width(), core.get_input_height()));
+      }
+    }
 
-    auto core_result = core.run(preprocessed_image);
+    // Gather a batch of frames, pre processing each straight into its place
+    // in the model's input tensor, cropped to the user
+    frames.clear();
+    regions.clear();
+    while (frames.size() < core.get_batch_size() && running) {
+      auto raw_next_frame = frame_generator.next_frame();
+      frames_in.add();
+      TRACE_SET_FRAME(raw_next_frame.id);
+      PreProcessing::Region region = roi_tracker.next();
+      try {
+        TRACE_SPAN("PreProcess", raw_next_frame.id);
+        core_preprocessor->run(raw_next_frame.raw_image,
+                               core.input(frames.size()),
+                               frame_generator.pixel_format(), region);
+      } catch (const std::exception& e) {
+        // Skip the frame, and let the post processing thread move on past it
+        fprintf(stderr, "Frame %" PRIu64 " dropped: %s\n", raw_next_frame.id,
+                e.what());
+        frames_failed.add();
+        core_results.abandon(raw_next_frame.id);
+        continue;
+      }
+      frames.push_back(std::move(raw_next_frame));
+      regions.push_back(region);
+    }
+    if (frames.empty()) {
+      continue;
+    }
 
-    core_results.push(CoreResults{
-        raw_next_frame.id, std::move(raw_next_frame.raw_image), core_result});
+    if (!deliver_batch(&core, &frames, regions, running_generation,
+                       &core_results)) {
+      frames_failed.add(frames.size());
+    }
+  }
+}
+
+/**
+ * @brief Size to display a frame of `frame_size` at
+ *
+ */
+static cv::Size preview_size(cv::Size frame_size) {
+  if (frame_size.width <= PREVIEW_MAX_WIDTH) {
+    return frame_size;
   }
+  return cv::Size(PREVIEW_MAX_WIDTH, frame_size.height * PREVIEW_MAX_WIDTH /
+                                         frame_size.width);
 }
 
 void Pipeline::post_processing_thread_body() {
+  TRACE_THREAD_NAME("Post processing");
+  // Frame rate is measured over windows of at least `FPS_WINDOW` ms
+  auto window_start = std::chrono::steady_clock::now();
+  uint64_t window_frames = 0;
+  PreProcessing::Resampler preview_resampler;
   while (running) {
     auto next_frame = core_results.pop();
     if (!next_frame.valid) {
       // Buffer has been told to stop
       break;
     }
+    TRACE_INSTANT("Reorder buffer exit", next_frame.value.id);
+    TRACE_SET_FRAME(next_frame.value.id);
+
+    PostProcessing::ProcessedResults processed_results;
+    {
+      TRACE_SPAN("PostProcess", next_frame.value.id);
+      processed_results = post_processor.run(next_frame.value.image_results);
+      roi_tracker.update(processed_results);
+    }
+    // Only convert the frame to RGB once scaled down for display
+    cv::Mat preview;
+    {
+      TRACE_SPAN("Preview", next_frame.value.id);
+      auto format = frame_generator.pixel_format();
+      preview = preview_resampler.resample(
+          next_frame.value.raw_image, format,
+          preview_size(PreProcessing::Resampler::frame_size(
+              next_frame.value.raw_image, format)),
+          FrameSource::RGB);
+      // Hand capture buffers back as soon as possible
+      next_frame.value.raw_image.release();
+    }
+
+    PostureEstimating::PoseStatus pose_result;
+    {
+      TRACE_SPAN("PostureEstimation", next_frame.value.id);
+      pose_result = posture_estimator.runEstimator(processed_results);
+      posture_estimator.analysePosture(pose_result, preview);
+    }
+    {
+      TRACE_SPAN("Callback", next_frame.value.id);
+      callback(pose_result, preview);
+    }
+
+    frames_out.add();
+    frame_latency_us.record_since(next_frame.value.entered);
+    govern(next_frame.value);
+    window_frames++;
+    auto now = std::chrono::steady_clock::now();
+    auto window = std::chrono::duration<double>(now - window_start);
+    if (window >= std::chrono::milliseconds(FPS_WINDOW)) {
+      fps.set(window_frames / window.count());
+      window_start = now;
+      window_frames = 0;
+      update_buffer_metrics();
+    }
+  }
+}
+
+void Pipeline::govern(const CoreResults& frame) {
+  if (!governor_enabled) {
+    governing = false;
+    return;
+  }
+  if (!governing) {
+    // Start at the governor's variant, whatever was run before
+    governed_generation = switch_variant(governor.get_current());
+    governing = true;
+    return;
+  }
+  if (frame.input_generation < governed_generation) {
+    return;
+  }
+
+  double latency_ms = std::chrono::duration<double, std::milli>(
+                          std::chrono::steady_clock::now() - frame.entered)
+                          .count();
+  size_t current = governor.get_current();
+  double budget_ms = QoS::latency_budget(
+      framerate_settings.get_framerate_setting().frame_delay,
+      num_cores * batch_size);
+  size_t next = governor.update(latency_ms, budget_ms);
+  if (next != current) {
+    governed_generation = switch_variant(next);
+    qos_switches.add();
+  }
+}
 
-    auto pose_result = posture_estimator.runEstimator(
-        post_processor.run(next_frame.value.image_results));
-    posture_estimator.analysePosture(pose_result, next_frame.value.raw_image);
-    callback(pose_result, next_frame.value.raw_image);
+uint64_t Pipeline::switch_variant(size_t index) {
+  const QoS::Variant& variant = governor.get_variants()[index];
+  Metrics::gauge("qos.variant").set(index);
+  std::lock_guard<std::mutex> lock(input_mutex);
+  return set_input(models.at(variant.model_filename),
+                   cv::Size(variant.input_width, variant.input_height));
+}
+
+uint64_t Pipeline::set_input(std::shared_ptr<const Inference::Model> model,
+                             cv::Size size) {
+  if (model != input_model || size != input_size) {
+    input_model = std::move(model);
+    input_size = size;
+    preprocessor.reset(
+        new PreProcessing::PreProcessor(size.width, size.height, num_cores));
+    input_generation++;
+    Metrics::gauge("inference.input_width").set(size.width);
+    Metrics::gauge("inference.input_height").set(size.height);
+  }
+  return input_generation;
+}
+
+void Pipeline::update_buffer_metrics(void) {
+  auto stats = core_results.stats();
+  Metrics::gauge("core_results.occupancy").set(stats.occupancy);
+  Metrics::gauge("core_results.dropped").set(stats.dropped);
+  Metrics::gauge("core_results.lost").set(stats.lost);
+  Metrics::gauge("core_results.late").set(stats.late);
+
+  std::shared_ptr<PreProcessing::PreProcessor> current;
+  {
+    std::lock_guard<std::mutex> lock(input_mutex);
+    current = preprocessor;
   }
+  auto scratch = current->scratch_stats();
+  Metrics::gauge("pre_processor.scratch_high_water").set(scratch.high_water);
+  Metrics::gauge("pre_processor.scratch_waits").set(scratch.waits);
 }
 
 Pipeline::Pipeline(uint8_t num_inference_core_threads,
-                   void (*callback)(PostureEstimating::PoseStatus, cv::Mat))
+                   void (*callback)(PostureEstimating::PoseStatus, cv::Mat),
+                   std::unique_ptr<FrameSource::FrameSource> frame_source,
+                   Buffer::Policy core_results_policy,
+                   CaptureMode capture_mode, uint8_t threads_per_core,
+                   uint8_t batch_size)
     : framerate_settings(this),
-      preprocessor(MODEL_INPUT_X, MODEL_INPUT_Y),
+      num_cores(num_inference_core_threads),
+      batch_size(batch_size),
+      preprocessor(new PreProcessing::PreProcessor(
+          MODEL_INPUT_X, MODEL_INPUT_Y, num_inference_core_threads)),
+      input_size(MODEL_INPUT_X, MODEL_INPUT_Y),
+      governor(model_variants()),
       // Disable smoothing with empty settings
       post_processor(
           CONFIDENCE_THRESH_DEFAULT,
           framerate_settings.get_framerate_setting().smoothing_settings),
       posture_estimator(),
-      frame_generator(),
-      core_results(&this->running, num_inference_core_threads),
-      callback(callback) {
+      frame_generator(std::move(frame_source), capture_mode),
+      // Inference core threads abandon the frames they fail on, so a frame
+      // that is merely slow is waited for. `LOST_FRAME_TIMEOUT` only guards
+      // against a frame disappearing without being abandoned
+      core_results(num_inference_core_threads * batch_size,
+                   Buffer::ReorderWindow{0, LOST_FRAME_TIMEOUT},
+                   core_results_policy),
+      callback(callback),
+      frames_in(Metrics::counter("pipeline.frames_in")),
+      frames_failed(Metrics::counter("pipeline.frames_failed")),
+      frames_out(Metrics::counter("pipeline.frames_out")),
+      frame_latency_us(Metrics::histogram("pipeline.frame_latency_us")),
+      fps(Metrics::gauge("pipeline.fps")),
+      target_fps(Metrics::gauge("pipeline.target_fps")),
+      qos_switches(Metrics::counter("qos.switches")) {
   if (num_inference_core_threads == 0) {
     throw std::invalid_argument("num_inference_core_threads must not be zero");
   }
+  if (threads_per_core == 0) {
+    throw std::invalid_argument("threads_per_core must not be zero");
+  }
+  if (batch_size == 0) {
+    throw std::invalid_argument("batch_size must not be zero");
+  }
   this->running = true;
 
-  // Create multiple inference core threads to improve performance
+  // Create multiple inference core threads to improve performance. They share
+  // one copy of the model, and each only owns an interpreter
+  auto loading = std::chrono::steady_clock::now();
+  std::shared_ptr<const Inference::Model> model =
+      std::make_shared<Inference::Model>(MODEL_FILENAME);
+  input_model = model;
+  models.emplace(MODEL_FILENAME, model);
   for (; num_inference_core_threads > 0; num_inference_core_threads--) {
-    Inference::InferenceCore core("assets/EfficientPoseRT_LITE.tflite",
-                                  MODEL_INPUT_X, MODEL_INPUT_Y);
+    Inference::InferenceCore core(
+        model, MODEL_INPUT_X, MODEL_INPUT_Y, threads_per_core,
+        SUBPIXEL_REFINEMENT,
+        Inference::LocalSearch{LOCAL_SEARCH_RADIUS, LOCAL_SEARCH_MIN_CONFIDENCE,
+                               LOCAL_SEARCH_PERIOD},
+        batch_size);
 
     std::thread core_thread(&Pipeline::Pipeline::core_thread_body, this,
                             std::move(core));
     threads.push_back(std::move(core_thread));
   }
+  Metrics::gauge("inference.input_width").set(MODEL_INPUT_X);
+  Metrics::gauge("inference.input_height").set(MODEL_INPUT_Y);
+  Metrics::gauge("qos.variant").set(0);
+  Metrics::gauge("inference.startup_ms")
+      .set(std::chrono::duration<double, std::milli>(
+               std::chrono::steady_clock::now() - loading)
+               .count());
 
   std::thread post_processing_thread(
       &Pipeline::Pipeline::post_processing_thread_body, this);
   threads.push_back(std::move(post_processing_thread));
 
+  target_fps.set(get_framerate());
   frame_generator.startms(
       framerate_settings.get_framerate_setting().frame_delay);
 }
@@ -148,6 +447,7 @@ Pipeline::Pipeline(uint8_t num_inference_core_threads,
 Pipeline::~Pipeline() {
   printf("Pipeline stopping\n");
   this->running = false;
+  core_results.stop();
   for (auto& t : this->threads) {
     t.join();
   }
@@ -163,6 +463,7 @@ float Pipeline::get_confidence_threshold() {
 
 void Pipeline::updated_framerate(FramerateSetting new_settings) {
   frame_generator.updated_framerate(new_settings.frame_delay);
+  target_fps.set(1000.0 / new_settings.frame_delay);
   post_processor = PostProcessing::PostProcessor(
       get_confidence_threshold(), new_settings.smoothing_settings);
 }
@@ -181,6 +482,41 @@ float Pipeline::get_framerate(void) {
   return 1000.0 / framerate_settings.get_framerate_setting().frame_delay;
 }
 
+bool Pipeline::set_input_resolution(size_t width, size_t height) {
+  if (width == 0 || height == 0) {
+    return false;
+  }
+  std::lock_guard<std::mutex> lock(input_mutex);
+  set_input(input_model, cv::Size(width, height));
+  return true;
+}
+
+cv::Size Pipeline::get_input_resolution(void) {
+  std::lock_guard<std::mutex> lock(input_mutex);
+  return input_size;
+}
+
+void Pipeline::set_qos_governor(bool enabled) {
+  if (enabled) {
+    // Load every model up front, so that switching never waits for one
+    for (auto& variant : governor.get_variants()) {
+      {
+        std::lock_guard<std::mutex> lock(input_mutex);
+        if (models.count(variant.model_filename)) {
+          continue;
+        }
+      }
+      auto model =
+          std::make_shared<Inference::Model>(variant.model_filename.c_str());
+      std::lock_guard<std::mutex> lock(input_mutex);
+      models.emplace(variant.model_filename, std::move(model));
+    }
+  }
+  governor_enabled = enabled;
+}
+
+bool Pipeline::get_qos_governor(void) { return governor_enabled; }
+
 void Pipeline::set_ideal_posture(PostureEstimating::Pose pose) {
   posture_estimator.update_ideal_pose(pose);
 }
@@ -193,4 +529,8 @@ float Pipeline::get_pose_change_threshold() {
   return posture_estimator.get_pose_change_threshold();
 }
 
+Buffer::Stats Pipeline::get_core_results_stats(void) {
+  return core_results.stats();
+}
+
 }  // namespace Pipeline
@@ -23,212 +23,55 @@
 #define SRC_PIPELINE_H_
 
 #include <CppTimer.h>
+#include <inttypes.h>
+#include <stdio.h>
 
+#include <atomic>
+#include <chrono>              //NOLINT [build/c++11]
 #include <condition_variable>  //NOLINT [build/c++11]
 #include <deque>
-#include <mutex>   //NOLINT [build/c++11]
+#include <exception>
+#include <map>
+#include <memory>
+#include <mutex>  //NOLINT [build/c++11]
+#include <string>
 #include <thread>  //NOLINT [build/c++11]
 #include <vector>
 
+#include "buffer.h"
+#include "frame_source.h"
 #include "iir.h"
 #include "inference_core.h"
+#include "metrics.h"
 #include "opencv2/core.hpp"
-#include "opencv2/videoio.hpp"
 #include "post_processor.h"
 #include "posture_estimator.h"
 #include "pre_processor.h"
+#include "qos_governor.h"
+#include "resample.h"
+#include "roi_tracker.h"
+#include "trace.h"
 
 #define FRAME_DELAY_MAX 2000      ///< Maximum settable frame delay, i.e., 0.5Hz
 #define FRAME_DELAY_MIN 50        ///< Minimum settable frame delay, i.e., 20Hz
 #define FRAME_DELAY_DEFAULT 1000  ///< Default delay between frames in ms
 
 /**
- * @brief A synchronising buffer and results structure
+ * @brief Width in pixels above which frames are scaled down for display
  *
  */
-namespace Buffer {
+#define PREVIEW_MAX_WIDTH 640
 
 /**
- * @brief Result when calling `Buffer::pop()`
+ * @brief Time in ms after which a frame that has not come out of the inference
+ * stage is declared lost, once a later frame has
  *
- * The structure has a field to indicate the validity of the result. It is
- * possible for the buffer to return a result when the owning pipeline is shut
- * down. In this situation the result could be invalid as the call to `pop()`
- * may be blocking until data is available. In this situation a `valid` flag of
- * `false` means the `value` field should not be used. A `valid` flag of `true`
- * means the `value` is useable from the buffer's perspective.
+ * Frames that fail are abandoned straight away, so this only catches a frame
+ * that disappears otherwise. Generous compared to the inference time on a
+ * Raspberry Pi, so that a slow frame is never skipped
  *
- * @tparam T Type of elements on the buffer
  */
-template <typename T>
-struct PopResult {
-  T value;     ///< Actual popped result
-  bool valid;  ///< Indicates validity of the result
-};
-
-/**
- * @brief A synchronising buffer to be used as a communication mechanism between
- * threads
- *
- * The buffer ensures that elements are in order based on the element's `id`
- * field. Attempting to `push` an element that is not next in line will block
- * until the missing element has been pushed by a different thread. An object of
- * this class may therefore be used to share the load at any stage in a pipeline
- * between multiple threads without needing to worry about issues in the order
- * of elements.
- *
- * It is implemented as a circular buffer.
- *
- * @tparam T The type for elements in the buffer. This must provide an `id`
- * field that is a `uint8_t`.
- */
-template <typename T>
-class Buffer {
- private:
-  std::mutex lock_in;    ///< `std::mutex` for input to the object
-  std::mutex lock_out;   ///< `std::mutex` for output of the object
-  std::vector<T> queue;  ///< Underlying queueing mechanism
-
-  size_t front_index = 0;  ///< Front (next to be popped) of the buffer
-  size_t back_index = 0;   ///< Back (where to push) of the buffer
-
-  /**
-   * @brief Flag to indicate if the pipeline is running
-   *
-   * When this becomes `false` any blocked threads should be allowed to quit,
-   * i.e., infinite loops should exit
-   *
-   */
-  bool* running;
-
-  /**
-   * @brief ID number for the newest frame on the queue
-   *
-   * The next frame that will be added to the queue will therefore be `id + 1`.
-   * An ID of `255` is defined to be followed by an ID of `0`, meaning there are
-   * no problems due to an integer overflow.
-   *
-   */
-  uint8_t id = -1;
-
-  /**
-   * @brief Get the current number of elements in the buffer
-   *
-   * @return `size_t` number of elements in the buffer
-   */
-  size_t size(void) {
-    int size = back_index - front_index;
-    if (size < 0) {
-      return (queue.size() + size);
-    }
-    return size;
-  }
-
-  /**
-   * @brief Flag to indicate if the buffer is full
-   *
-   */
-  bool full = false;
-
- public:
-  /**
-   * @brief Construct a new `Buffer` object
-   *
-   * @param running_ptr Pointer to the `Pipeline::Pipeline::running` flag
-   * @param max_size Maximum desired useable size of underlying memory
-   */
-  explicit Buffer(bool* running_ptr, size_t max_size)
-      : running(running_ptr), queue(max_size) {}
-
-  /**
-   * @brief Push a frame to the queue
-   *
-   * This blocks if the frame's ID is not the next in the series, until the
-   * missing frame has been pushed by another thread. Also blocks if the maximum
-   * size is reached, until elements are popped.
-   *
-   * @tparam frame Frame to be pushed to the queue
-   */
-  void push(T frame) {
-    while (*running) {
-      lock_in.lock();
-      if ((uint8_t)(id + 1) == frame.id && !full) {
-        queue.at(back_index) = frame;
-        back_index = (back_index + 1) % queue.size();
-        if (back_index == front_index) {
-          full = true;
-        }
-
-        id++;
-        lock_in.unlock();
-        break;
-      }
-      lock_in.unlock();
-    }
-  }
-
-  /**
-   * @brief Push a frame to the queue (doesn't block if queue is full)
-   *
-   * This blocks if the frame's ID is not the next in the series, until the
-   * missing frame has been pushed by another thread. It returns if the queue is
-   * full.
-   *
-   * @param frame Frame to be pushed to the queue
-   * @return `true` If pushing was successful
-   * @return `false` If the frame was not pushed, i.e., the queue was full; or
-   * the pipeline is halting
-   */
-  bool try_push(T frame) {
-    while (*running) {
-      // Immediately return if the queue is full
-      lock_in.lock();
-      if (full) {
-        lock_in.unlock();
-        return false;
-      }
-
-      if ((uint8_t)(id + 1) == frame.id) {
-        queue.at(back_index) = frame;
-        back_index = (back_index + 1) % queue.size();
-        if (front_index == back_index) {
-          full = true;
-        }
-
-        id++;
-        lock_in.unlock();
-        return true;
-      } else {
-        lock_in.unlock();
-      }
-    }
-    return false;
-  }
-
-  /**
-   * @brief Pop the oldest element in the queue and return it
-   *
-   * @return `PopResult<T>` Oldest frame on the queue. Note: the `valid` flag of
-   * the result must be checked before use.
-   */
-  PopResult<T> pop() {
-    PopResult<T> front = PopResult<T>{T{}, false};
-    while (*running) {
-      lock_out.lock();
-      if (size() != 0 || full) {
-        front = PopResult<T>{queue.at(front_index), true};
-        front_index = (front_index + 1) % queue.size();
-        full = false;
-
-        lock_out.unlock();
-        break;
-      }
-      lock_out.unlock();
-    }
-    return front;
-  }
-};
-}  // namespace Buffer
+#define LOST_FRAME_TIMEOUT 5000
 
 /**
  * @brief Components of the pipeline at the core of the system
@@ -331,7 +174,7 @@ struct PreprocessedFrame {
    * processing. This id must be passed through the entire pipeline.
    *
    */
-  uint8_t id;
+  uint64_t id;
   cv::Mat raw_image;
   PreProcessing::PreProcessedImage preprocessed_image;
 };
@@ -341,8 +184,48 @@ struct PreprocessedFrame {
  *
  */
 struct RawFrame {
-  uint8_t id;         ///< Frame ordering ID
+  uint64_t id;        ///< Frame ordering ID
   cv::Mat raw_image;  ///< Raw `cv::Mat` (OpenCV) image
+  std::chrono::steady_clock::time_point entered;  ///< When it entered the
+                                                  ///< pipeline
+};
+
+/**
+ * @brief A frame as published by the capture thread of the `FrameGenerator`
+ *
+ * The times are only set while tracing, see `trace.h`. The frame is only given
+ * an ID once it enters the pipeline, so that is when its capture is traced.
+ *
+ */
+struct CapturedFrame {
+  cv::Mat image;
+  Trace::Clock::time_point grabbed;    ///< When grabbing the frame started
+  Trace::Clock::time_point retrieved;  ///< When decoding the frame finished
+  uint32_t tid;  ///< `Trace::thread_id()` of the capture thread
+};
+
+/**
+ * @brief How the `FrameGenerator` reads frames from its source
+ *
+ */
+enum CaptureMode {
+  /**
+   * @brief Fully read every frame the source produces, so that a decoded frame
+   * is ready the moment the timer fires
+   *
+   */
+  DecodeAll,
+
+  /**
+   * @brief Grab every frame to keep the source fresh, but only decode the
+   * frame following each timer tick
+   *
+   * Saves decoding frames that are never used when the frame rate of the
+   * pipeline is below that of the camera, at the cost of up to one camera
+   * frame of extra latency.
+   *
+   */
+  DecodeOnDemand,
 };
 
 /**
@@ -354,37 +237,61 @@ struct RawFrame {
 class FrameGenerator : public CppTimer {
  private:
   /**
-   * @brief Video stream handle
+   * @brief Where the frames come from, e.g. a camera
    *
    */
-  cv::VideoCapture cap;
+  std::unique_ptr<FrameSource::FrameSource> source;
+
+  CaptureMode capture_mode;
+
+  /**
+   * @brief Whether the timer has fired and is waiting for a frame to be
+   * decoded, when using `DecodeOnDemand`
+   *
+   */
+  std::atomic<bool> frame_requested{false};
+
+  /**
+   * @brief Whether a frame has been released to the next caller of
+   * `next_frame()`
+   *
+   * Kept until it is taken, so a frame released while no caller is waiting,
+   * e.g. while an inference core thread pre processes the previous frame of
+   * its batch, is not missed. At most one is kept, so that frames are never
+   * handed out in a burst.
+   *
+   * Access to this should be protected by `mutex`
+   *
+   */
+  bool frame_released = false;
 
   /**
    * @brief Identifier to keep track of frame ordering
    *
    * Each frame is labelled with an ID that increments by one from one frame to
-   * the next. The FrameGenerator never skips and ID. Once the maximum value is
-   * reached, the number overflows and wraps back to zero. Therefore the maximum
-   * number possible for the ID is less than zero, i.e., it is always possible
-   * to determine what the next expected frame ID is.
+   * the next. The FrameGenerator never skips an ID. The ID is 64 bits wide so
+   * that it never wraps around in practice.
    *
    * Access to this should be protected by `lock`
    *
    */
-  uint8_t id = 0;
+  uint64_t id = 0;
 
   /**
-   * @brief The most up-to-date frame retrieved from the camera
+   * @brief The most up-to-date frame retrieved from the `source`
    *
-   * Access to this should be protected by `lock`
+   * The capture thread publishes every frame here without taking `mutex`, so
+   * it never waits for the inference core threads. Only read in
+   * `next_frame()` while holding `mutex`, hence a single reader.
    *
    */
-  cv::Mat current_frame;
+  Buffer::LatestSlot<CapturedFrame> current_frame{1};
 
   /**
    * @brief Lock to protect the most current frame-related data
    *
-   * Enables the synchronisation of `id` and `current_frame`
+   * Serialises callers of `next_frame()`, so that frames are read from
+   * `current_frame` in the order of their `id`
    *
    */
   std::mutex mutex;
@@ -410,7 +317,7 @@ class FrameGenerator : public CppTimer {
   std::thread thread;
 
   /**
-   * @brief Implementation of how to retrieve the next frame from the camera
+   * @brief Implementation of how to retrieve the next frame from the `source`
    *
    */
   void thread_body(void);
@@ -420,12 +327,21 @@ class FrameGenerator : public CppTimer {
    *
    * When the timer fires, at most one thread currently waiting in a
    * `next_frame()` call will be notified and will start to process the frame.
+   * With `DecodeOnDemand` this happens once the capture thread has decoded the
+   * next frame.
    *
    * This timer controls the frame rate of the pipeline.
    *
    */
   void timerEvent(void);
 
+  /**
+   * @brief Let one caller of `next_frame()` take the current frame, see
+   * `frame_released`
+   *
+   */
+  void release_frame(void);
+
   /**
    * @brief Flag to tell `thread_body` whether or not it should be running
    *
@@ -436,9 +352,12 @@ class FrameGenerator : public CppTimer {
   /**
    * @brief Construct a new Frame Generator object
    *
-   * @throw `std::runtime_error` if the camera cannot be accessed
+   * @param source Source to read frames from
+   * @param capture_mode Whether to decode every frame from `source`
+   * @throw `std::runtime_error` if no frame can be read from `source`
    */
-  FrameGenerator(void);
+  explicit FrameGenerator(std::unique_ptr<FrameSource::FrameSource> source,
+                          CaptureMode capture_mode = DecodeAll);
 
   /**
    * @brief Destroy the Frame Generator object
@@ -460,9 +379,17 @@ class FrameGenerator : public CppTimer {
   /**
    * @brief Get the newest frame
    *
-   * @return `RawFrame` The most up-to-date frame from the camera
+   * Waits until the timer releases the next frame
+   *
+   * @return `RawFrame` The most up-to-date frame from the `source`
    */
   RawFrame next_frame(void);
+
+  /**
+   * @brief Get the pixel format of the frames, see `FrameSource::PixelFormat`
+   *
+   */
+  FrameSource::PixelFormat pixel_format(void);
 };
 
 /**
@@ -477,11 +404,65 @@ struct CoreResults {
    * processing. This id must be passed through the entire pipeline.
    *
    */
-  uint8_t id;
+  uint64_t id;
   cv::Mat raw_image;
   Inference::InferenceResults image_results;
+  std::chrono::steady_clock::time_point entered;  ///< See `RawFrame`
+  /**
+   * @brief The `Pipeline::input_generation` of the model and resolution it was
+   * run at, which is older than the latest if switching to it failed
+   *
+   */
+  uint64_t input_generation;
 };
 
+/**
+ * @brief Run the model on a batch of frames, and push the result of each to
+ * `results`, or abandon them all if running the model fails
+ *
+ * @tparam Core Runs the model like `Inference::InferenceCore::run_batch()`
+ * @param core Holds the pre processed frames
+ * @param frames Frames of the batch, in order. Their images are moved into
+ * `results`
+ * @param regions Region of each frame that the model was given
+ * @param input_generation See `CoreResults`
+ * @param results Where to push the results
+ * @return `true` If the results were pushed
+ */
+template <typename Core>
+bool deliver_batch(Core* core, std::vector<RawFrame>* frames,
+                   const std::vector<PreProcessing::Region>& regions,
+                   uint64_t input_generation,
+                   Buffer::SequencedRing<CoreResults>* results) {
+  std::vector<uint64_t> ids;
+  for (auto& frame : *frames) {
+    ids.push_back(frame.id);
+  }
+  std::vector<Inference::InferenceResults> batch_results;
+  try {
+    batch_results = core->run_batch(frames->size(), regions.data(), ids.data());
+  } catch (const std::exception& e) {
+    // Let the post processing thread move on past the whole batch
+    fprintf(stderr, "Frames %" PRIu64 " to %" PRIu64 " dropped: %s\n",
+            frames->front().id, frames->back().id, e.what());
+    for (auto& frame : *frames) {
+      results->abandon(frame.id);
+    }
+    return false;
+  }
+
+  // Scatter the results back to their frames, in order
+  for (size_t i = 0; i < frames->size(); i++) {
+    RawFrame& frame = (*frames)[i];
+    TRACE_INSTANT("Reorder buffer enter", frame.id);
+    results->push(CoreResults{
+        frame.id, std::move(frame.raw_image),
+        PreProcessing::RoiTracker::to_frame(regions[i], batch_results[i]),
+        frame.entered, input_generation});
+  }
+  return true;
+}
+
 /**
  * @brief Frame-by-frame pipeline to process video
  *
@@ -512,12 +493,128 @@ class Pipeline {
 
   FramerateSettings framerate_settings;
 
-  PreProcessing::PreProcessor preprocessor;
+  /**
+   * @brief Number of inference core threads
+   *
+   */
+  uint8_t num_cores;
+
+  /**
+   * @brief Number of frames each inference core thread runs the model on at
+   * once
+   *
+   */
+  uint8_t batch_size;
+
+  /**
+   * @brief Pre processes frames to the current `input_size`
+   *
+   * Replaced by `set_input()`. Each inference core thread holds on
+   * to the one matching its interpreter until it picks up the next
+   * `input_generation`, so both resolutions can be in use for a moment.
+   *
+   */
+  std::shared_ptr<PreProcessing::PreProcessor> preprocessor;
+
+  /**
+   * @brief Resolution the model is run at
+   *
+   */
+  cv::Size input_size;
+
+  /**
+   * @brief Model the inference core threads run
+   *
+   */
+  std::shared_ptr<const Inference::Model> input_model;
+
+  /**
+   * @brief Every model loaded, by filename, so that switching to one never
+   * waits for it to load
+   *
+   */
+  std::map<std::string, std::shared_ptr<const Inference::Model>> models;
+
+  /**
+   * @brief Protects `preprocessor`, `input_size`, `input_model` and `models`
+   *
+   */
+  std::mutex input_mutex;
+
+  /**
+   * @brief Incremented by every change of `set_input()`
+   *
+   * Inference core threads compare it to the generation they last picked up
+   * before each batch, which is the only time they hold no frames, so that
+   * checking for a change does not take `input_mutex`.
+   *
+   */
+  std::atomic<uint64_t> input_generation{0};
+
+  /**
+   * @brief Chooses the variant of the model from the latency of each frame,
+   * see `set_qos_governor()`
+   *
+   * Only used by the post processing thread, apart from its variants which
+   * never change
+   *
+   */
+  QoS::Governor governor;
+  std::atomic<bool> governor_enabled{false};
+
+  /**
+   * @brief Whether the inference cores were switched to the `governor`'s
+   * variant since it was enabled, only used by the post processing thread
+   *
+   */
+  bool governing = false;
+
+  /**
+   * @brief `input_generation` of the `governor`'s last switch, only used by
+   * the post processing thread
+   *
+   */
+  uint64_t governed_generation = 0;
+
+  /**
+   * @brief Switch the inference core threads to `model` at `size`, see
+   * `input_generation`
+   *
+   * Must be called with `input_mutex` held
+   *
+   * @return `uint64_t` The `input_generation` the cores switch to
+   */
+  uint64_t set_input(std::shared_ptr<const Inference::Model> model,
+                     cv::Size size);
+
+  /**
+   * @brief Switch the inference core threads to a variant of the `governor`
+   *
+   * @return `uint64_t` The `input_generation` the cores switch to
+   */
+  uint64_t switch_variant(size_t index);
+
+  /**
+   * @brief Pass the latency of a frame to the `governor`, if enabled, and
+   * switch variant when it says so
+   *
+   * Frames run before the last switch are left out, as they say nothing about
+   * the current variant.
+   *
+   */
+  void govern(const CoreResults& frame);
+
+  /**
+   * @brief Crops frames to the user, based on the post processed results of
+   * earlier frames
+   *
+   */
+  PreProcessing::RoiTracker roi_tracker;
   PostProcessing::PostProcessor post_processor;
   PostureEstimating::PostureEstimator posture_estimator;
 
   FrameGenerator frame_generator;
-  Buffer::Buffer<CoreResults> core_results;
+  Buffer::SequencedRing<CoreResults> core_results;
 
   /**
    * @brief Function that provides the body for the inference core thread
@@ -536,7 +633,8 @@ class Pipeline {
    *
    * This function is called once for every frame that passes out of the
    * pipeline and provides a `PostureEstimating::PoseStatus` structure as well
-   * as the original image that led to these results. It is then up to the
+   * as the image that led to these results, in RGB and scaled down to at most
+   * `PREVIEW_MAX_WIDTH` with the pose drawn on top. It is then up to the
    * callback to handle the output. As this is a callback, the body of the
    * function should not include compute-heavy code as this will slow down the
    * output frame rate.
@@ -544,6 +642,27 @@ class Pipeline {
    */
   void (*callback)(PostureEstimating::PoseStatus, cv::Mat);
 
+  /**
+   * @brief Metrics the pipeline keeps up to date, see `metrics.h`
+   *
+   * Looked up once here so the threads only ever touch the atomics
+   *
+   */
+  Metrics::Counter& frames_in;      ///< Frames taken by inference core threads
+  Metrics::Counter& frames_failed;  ///< Frames dropped due to an exception
+  Metrics::Counter& frames_out;     ///< Frames passed to the `callback`
+  Metrics::Histogram& frame_latency_us;  ///< From `next_frame()` to `callback`
+  Metrics::Gauge& fps;         ///< Achieved output frame rate in Hz
+  Metrics::Gauge& target_fps;  ///< Frame rate the timer is set to in Hz
+  Metrics::Counter& qos_switches;  ///< Variants switched to by `governor`
+
+  /**
+   * @brief Publish the stats of `core_results` and the pre processing memory
+   * pool as gauges
+   *
+   */
+  void update_buffer_metrics(void);
+
  public:
   void updated_framerate(FramerateSetting new_settings);
 
@@ -555,9 +674,26 @@ class Pipeline {
    * @param num_inference_core_threads The number of threads to use for the
    * inference core stage
    * @param callback Function to call for every frame output by the pipeline
-   */
-  explicit Pipeline(uint8_t num_inference_core_threads,
-                    void (*callback)(PostureEstimating::PoseStatus, cv::Mat));
+   * @param frame_source Where to get frames from, e.g. `FrameSource::Camera`
+   * @param core_results_policy What inference core threads do when the post
+   * processing stage falls behind. `Buffer::Block` keeps every frame in order,
+   * `Buffer::KeepLatest` only ever post processes the freshest pose
+   * @param capture_mode Whether to decode every frame from `frame_source` or
+   * only those that enter the pipeline
+   * @param threads_per_core Number of threads each inference core thread uses
+   * to run the model. Many single threaded cores give the best throughput,
+   * one multi threaded core the lowest latency per frame
+   * @param batch_size Number of consecutive frames each inference core thread
+   * gathers and runs the model on at once. Larger batches give more throughput
+   * per core, at the cost of latency, so suit the offline analysis of
+   * recordings rather than live use
+   */
+  Pipeline(uint8_t num_inference_core_threads,
+           void (*callback)(PostureEstimating::PoseStatus, cv::Mat),
+           std::unique_ptr<FrameSource::FrameSource> frame_source,
+           Buffer::Policy core_results_policy = Buffer::Block,
+           CaptureMode capture_mode = DecodeAll, uint8_t threads_per_core = 1,
+           uint8_t batch_size = 1);
 
   /**
    * @brief Destroy the Pipeline object
@@ -610,6 +746,58 @@ class Pipeline {
    */
   float get_framerate(void);
 
+  /**
+   * @brief Change the resolution the model is run at, e.g. 128, 160, 192 or
+   * 224 pixels square
+   *
+   * Lower resolutions are faster but locate body parts less precisely. Each
+   * inference core thread switches before its next batch of frames, so frames
+   * already being processed are not affected. While `set_qos_governor()` is
+   * enabled, its next switch overrides the resolution set here.
+   *
+   * @param width Width of the model's input in pixels
+   * @param height Height of the model's input in pixels
+   * @return `true` If updating the resolution succeeded
+   * @return `false` If either dimension is zero
+   */
+  bool set_input_resolution(size_t width, size_t height);
+
+  /**
+   * @brief Get the resolution the model is run at
+   *
+   * @return `cv::Size` Last set resolution, which the inference core threads
+   * may still be switching to
+   */
+  cv::Size get_input_resolution(void);
+
+  /**
+   * @brief Enable or disable switching between variants of the model to keep
+   * the latency of each frame within the frame delay
+   *
+   * When enabled, the pipeline starts at the most expensive variant, steps
+   * down to cheaper variants while frames take longer than the pipeline can
+   * sustain, and back up when there is headroom, see `QoS::Governor`. As the
+   * inference cores work in parallel, frames can take the frame delay times
+   * the number of frames in flight, see `QoS::latency_budget()`. Each switch
+   * takes effect like `set_input_resolution()`, and the post processing is
+   * carried on, so the smoothing of the results is not reset. When disabled,
+   * the current variant is kept.
+   *
+   * Every variant's model is loaded before the governor is enabled.
+   *
+   * @param enabled Whether to govern the variant of the model
+   * @throw `std::runtime_error` if a model cannot be loaded, in which case the
+   * governor is left as it was
+   */
+  void set_qos_governor(bool enabled);
+
+  /**
+   * @brief Check whether the variant of the model is governed, see
+   * `set_qos_governor()`
+   *
+   */
+  bool get_qos_governor(void);
+
   /**
    * @brief Set the ideal posture
    *
@@ -633,6 +821,18 @@ class Pipeline {
    * @return `float` Currently set pose change threshold
    */
   float get_pose_change_threshold();
+
+  /**
+   * @brief Get counters for the frames passed from the inference stage to the
+   * post processing stage
+   *
+   * This includes the number of frames that never came out of the inference
+   * stage and were skipped, frames dropped by the back-pressure policy, the
+   * current occupancy and how often each side had to wait.
+   *
+   * @return `Buffer::Stats`
+   */
+  Buffer::Stats get_core_results_stats(void);
 };
 }  // namespace Pipeline
 #endif  // SRC_PIPELINE_H_
@@ -84,6 +84,7 @@ ProcessedResults PostProcessor::run(
 
     for (; body_part_index < BodyPartMax + 1;
          body_part_index++, filter_index += NUM_FILTERS_PER_BODY_PART) {
+      if (!body_part_used(body_part_index)) continue;
       body_part = inference_core_output.body_parts.at(body_part_index);
 
       iir_filters.at(filter_index).set(body_part.x);
@@ -109,6 +110,8 @@ ProcessedResults PostProcessor::run(
 
   for (; body_part_index < BodyPartMax + 1;
        body_part_index++, filter_index += NUM_FILTERS_PER_BODY_PART) {
+    // Not decoded, see `joint_body_parts`
+    if (!body_part_used(body_part_index)) continue;
     body_part = inference_core_output.body_parts.at(body_part_index);
 
     // Filter the incoming position for each body part
@@ -128,35 +131,15 @@ ProcessedResults PostProcessor::run(
   }
 
   // Assemble results with the filtered data and any necessary averaging
-  // Head
-  results.body_parts.at(Head) = intermediate_results.at(head_top);
-
-  // Neck
-  results.body_parts.at(Neck) = intermediate_results.at(upper_neck);
-
-  // Shoulder
-  Coordinate mean_shoulder =
-      intelligent_mean_body_parts(intermediate_results.at(left_shoulder),
-                                  intermediate_results.at(right_shoulder));
-  results.body_parts.at(Shoulder) = mean_shoulder;
-
-  // Hip (from left/right hip and pelvis)
-  Coordinate mean_hip = intelligent_mean_body_parts(
-      intermediate_results.at(left_hip), intermediate_results.at(right_hip));
-  mean_hip =
-      intelligent_mean_body_parts(mean_hip, intermediate_results.at(pelvis));
-  results.body_parts.at(Hip) = mean_hip;
-
-  // Knee
-  Coordinate mean_knee = intelligent_mean_body_parts(
-      intermediate_results.at(left_knee), intermediate_results.at(right_knee));
-  results.body_parts.at(Knee) = mean_knee;
-
-  // Foot (from ankles)
-  Coordinate mean_ankle =
-      intelligent_mean_body_parts(intermediate_results.at(left_ankle),
-                                  intermediate_results.at(right_ankle));
-  results.body_parts.at(Foot) = mean_ankle;
+  for (int joint = JointMin; joint <= JointMax; joint++) {
+    const JointBodyParts& parts = joint_body_parts[joint];
+    Coordinate mean = intermediate_results.at(parts.body_parts[0]);
+    for (size_t i = 1; i < parts.count; i++) {
+      mean = intelligent_mean_body_parts(
+          mean, intermediate_results.at(parts.body_parts[i]));
+    }
+    results.body_parts.at(joint) = mean;
+  }
 
   return results;
 }
@@ -344,8 +344,6 @@ void PostureEstimator::analysePosture(PostureEstimating::PoseStatus pose_status,
   PostureEstimating::Pose pose_changes = pose_status.pose_changes;
   PostureEstimating::PostureState posture_state = pose_status.posture_state;
 
-  cv::cvtColor(current_frame, current_frame, cv::COLOR_BGR2RGB);
-
   if (posture_state == Undefined) {
     if (!this->undefinedPostureTimer.running) {
       this->undefinedPostureTimer.countdown();
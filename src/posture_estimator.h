@@ -458,7 +458,8 @@ class PostureEstimator {
    *
    * @param pose_status `PostureEstimating::PoseStatus` The pose status for
    * the current frame
-   * @param current_frame `cv::Mat` The current frame to overlay lines on to
+   * @param current_frame `cv::Mat` The current frame to overlay lines on to,
+   * in RGB
    */
   void analysePosture(PostureEstimating::PoseStatus pose_status,
                       cv::Mat current_frame);
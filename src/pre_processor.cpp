@@ -1,5 +1,5 @@
 /**
- * @copyright Copyright (C) 2021  Ashwin Maliampurakal
+ * @copyright Copyright (C) 2021  Miklas Riechmann
  *
  *  This program is free software: you can redistribute it and/or modify
  *  it under the terms of the GNU General Public License as published by
@@ -17,40 +17,92 @@
  */
 #include "pre_processor.h"
 
+#include <math.h>
+
+#include <algorithm>
+#include <chrono>  //NOLINT [build/c++11]
 #include <memory>
+#include <vector>
 
 #include "intermediate_structures.h"
+#include "metrics.h"
+#include "normalise.h"
 
 namespace PreProcessing {
 
-PreProcessor::PreProcessor(size_t model_width, size_t model_height)
-    : model_width(model_width), model_height(model_height) {}
+/**
+ * @brief Convert a `Region` to pixels of a frame of `frame_size`
+ *
+ * Rounds outwards to whole pixels, so the result is never empty
+ *
+ */
+static cv::Rect to_pixels(Region region, cv::Size frame_size) {
+  int left = floor(region.x * frame_size.width);
+  int top = floor(region.y * frame_size.height);
+  int right = ceil((region.x + region.width) * frame_size.width);
+  int bottom = ceil((region.y + region.height) * frame_size.height);
+  left = std::min(std::max(left, 0), frame_size.width - 1);
+  top = std::min(std::max(top, 0), frame_size.height - 1);
+  right = std::min(std::max(right, left + 1), frame_size.width);
+  bottom = std::min(std::max(bottom, top + 1), frame_size.height);
+  return cv::Rect(left, top, right - left, bottom - top);
+}
 
-void PreProcessor::normalise(uint8_t* resized_image, float* normalised_image) {
-  int size = model_width * model_height;
-  int step = 3;
+PreProcessor::PreProcessor(size_t model_width, size_t model_height,
+                           size_t max_threads)
+    : model_width(model_width),
+      model_height(model_height),
+      scratch(new Buffer::Pool<Scratch>(max_threads)) {}
 
-  for (int i = 0; i < size * step; i += step) {
-    // - Scale to [-1..1]
-    // - OpenCV uses BGR but the model uses RGB, therefore
-    //   the channels must also be switched.
-    uint8_t* img = &(resized_image[i]);
-    normalised_image[i + 0] = img[2] / 127.5 - 1;  // Switch R and B channels
-    normalised_image[i + 1] = img[1] / 127.5 - 1;
-    normalised_image[i + 2] = img[0] / 127.5 - 1;  // Switch B and R channels
+void PreProcessor::run(cv::Mat cv_image, PreProcessedImage destination,
+                       FrameSource::PixelFormat format, Region region) {
+  static Metrics::Histogram& run_us =
+      Metrics::histogram("pre_processor.run_us");
+  auto start = std::chrono::steady_clock::now();
+
+  // Returned to the pool when this goes out of scope, even if an exception is
+  // thrown
+  auto memory = scratch->acquire();
+  Resampler& resampler = memory->resampler;
+  resampler.start(cv_image, format, cv::Size(model_width, model_height),
+                  to_pixels(region, Resampler::frame_size(cv_image, format)));
+
+  bool quantised = destination.type != Float32Tensor;
+  if (quantised &&
+      (memory->table_type != destination.type ||
+       memory->table_quantisation.scale != destination.quantisation.scale ||
+       memory->table_quantisation.zero_point !=
+           destination.quantisation.zero_point)) {
+    // Only rebuilt when the model changes
+    quantise_table(destination.type, destination.quantisation, memory->table);
+    memory->table_type = destination.type;
+    memory->table_quantisation = destination.quantisation;
   }
-}
 
-PreProcessedImage PreProcessor::run(cv::Mat cv_image) {
-  cv::resize(cv_image, cv_image, cv::Size(model_width, model_height));
-  uint8_t* resized_image = cv_image.data;
+  // Each output row is resized into here and then normalised straight into
+  // `destination`
+  std::vector<uint8_t>& resized_row = memory->resized_row;
+  resized_row.resize(model_width * 3);
+  for (size_t y = 0; y < model_height; y++) {
+    resampler.row(y, resized_row.data(), FrameSource::BGR);
 
-  float* normalised_image = reinterpret_cast<float*>(
-      malloc(model_width * model_height * 3 * sizeof(float)));
+    // - Scale to [-1..1], or look up the quantised value
+    // - OpenCV uses BGR but the model uses RGB, therefore
+    //   the channels must also be switched.
+    if (quantised) {
+      quantise(memory->table, resized_row.data(),
+               &destination.quantised[y * model_width * 3], model_width);
+    } else {
+      normalise(resized_row.data(), &destination.image[y * model_width * 3],
+                model_width);
+    }
+  }
 
-  normalise(resized_image, normalised_image);
+  run_us.record_since(start);
+}
 
-  return PreProcessedImage{normalised_image};
+Buffer::PoolStats PreProcessor::scratch_stats(void) {
+  return scratch->stats();
 }
 
 }  // namespace PreProcessing
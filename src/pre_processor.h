@@ -26,9 +26,13 @@
 #include <stdint.h>
 
 #include <memory>
+#include <vector>
 
+#include "buffer.h"
+#include "frame_source.h"
 #include "intermediate_structures.h"
 #include "opencv2/opencv.hpp"
+#include "resample.h"
 
 /**
  * @brief Responsible for resizing and normalising
@@ -44,8 +48,15 @@ namespace PreProcessing {
  * This class contains some pre processing steps to allow an input image to be
  * passed to the `Inference::InferenceCore`. The following operations are
  * performed to process the raw data:
+ * - Crop the image to a region, if given
  * - Resize the image to fit the dimensions of the model being used
- * - Normalise the image pixels to the range [-1..1]
+ * - Normalise the image pixels to the range [-1..1], or quantise them for a
+ *   quantised model
+ *
+ * Both are done in a single pass, one output row at a time, so the only
+ * full-size buffer written is the destination, usually the model's input
+ * tensor. The little working memory needed comes from a pool, so that
+ * pre processing a frame does not allocate.
  *
  */
 class PreProcessor {
@@ -54,12 +65,30 @@ class PreProcessor {
   size_t model_height;
 
   /**
-   * @brief Normalise the input image to the required interval [-1..1]
+   * @brief Working memory for a single `run()`
+   *
+   */
+  struct Scratch {
+    Resampler resampler;
+    std::vector<uint8_t> resized_row;
+
+    /**
+     * @brief `quantise_table()` of the last quantised destination, if
+     * `table_type` is not `Float32Tensor`
+     *
+     */
+    uint8_t table[256];
+    TensorType table_type = Float32Tensor;
+    Quantisation table_quantisation = Quantisation{0, 0};
+  };
+
+  /**
+   * @brief One `Scratch` per thread that may call `run()` at once
+   *
+   * Held by pointer so the `PreProcessor` can be moved
    *
-   * @param resized_image Array of pixels of the resized input image
-   * @param normalised_image Memory allocated for the normalised image
    */
-  void normalise(uint8_t* resized_image, float* normalised_image);
+  std::unique_ptr<Buffer::Pool<Scratch>> scratch;
 
  public:
   /**
@@ -69,17 +98,41 @@ class PreProcessor {
    * `Inference::InferenceCore::model_input_width`)
    * @param model_height Desired height of the resized image (should match
    * `Inference::InferenceCore::model_input_height`)
+   * @param max_threads Number of threads that may call `run()` at once.
+   * Further threads wait for one of them to finish
    * @return The resized array of pixels of the input image
    */
-  PreProcessor(size_t model_width, size_t model_height);
+  PreProcessor(size_t model_width, size_t model_height,
+               size_t max_threads = 1);
 
   /**
    * @brief Apply pre processing to the given input image
    *
+   * The image is resized with bilinear interpolation, like `cv::resize()` with
+   * `cv::INTER_LINEAR`, see `Resampler`. YUV frames are only converted to RGB
+   * once resized.
+   *
    * @param cv_image The OpenCV image to be preprocessed
-   * @return `PreProcessedImage` after resizing and normalising
+   * @param destination Where to write the resized and normalised image, e.g.
+   * `Inference::InferenceCore::input()`. Quantised with `quantise()` instead
+   * if its `type` is not `Float32Tensor`
+   * @param format Pixel format of `cv_image`
+   * @param region Part of `cv_image` to crop to before resizing, see
+   * `RoiTracker`
+   * @throw `std::invalid_argument` if `cv_image` is not in `format`
+   */
+  void run(cv::Mat cv_image, PreProcessedImage destination,
+           FrameSource::PixelFormat format = FrameSource::BGR,
+           Region region = Region{0, 0, 1, 1});
+
+  /**
+   * @brief Get the usage of the working memory pool
+   *
+   * A high water mark below `max_threads` means fewer threads could share it
+   *
+   * @return `Buffer::PoolStats`
    */
-  PreProcessedImage run(cv::Mat cv_image);
+  Buffer::PoolStats scratch_stats(void);
 };
 
 }  // namespace PreProcessing
@@ -0,0 +1,91 @@
+/**
+ * @copyright Copyright (C) 2021  Miklas Riechmann
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "qos_governor.h"
+
+#include <stdexcept>
+#include <utility>
+
+namespace QoS {
+
+Governor::Governor(std::vector<Variant> variants, uint64_t sustain_frames,
+                   double headroom, double smoothing)
+    : variants(std::move(variants)),
+      sustain_frames(sustain_frames),
+      headroom(headroom),
+      smoothing(smoothing) {
+  if (this->variants.empty()) {
+    throw std::invalid_argument("At least one variant is needed");
+  }
+  for (size_t i = 0; i < this->variants.size(); i++) {
+    if (!(this->variants[i].cost > 0) ||
+        (i > 0 && this->variants[i].cost > this->variants[i - 1].cost)) {
+      throw std::invalid_argument(
+          "Variants must have positive costs, in decreasing order");
+    }
+  }
+}
+
+size_t Governor::update(double latency_ms, double budget_ms) {
+  if (have_latency) {
+    this->latency_ms += smoothing * (latency_ms - this->latency_ms);
+  } else {
+    this->latency_ms = latency_ms;
+    have_latency = true;
+  }
+
+  // Only consecutive frames count towards a switch
+  if (this->latency_ms > budget_ms) {
+    frames_missed++;
+  } else {
+    frames_missed = 0;
+  }
+  if (current > 0 && this->latency_ms * variants[current - 1].cost /
+                             variants[current].cost <
+                         headroom * budget_ms) {
+    frames_headroom++;
+  } else {
+    frames_headroom = 0;
+  }
+
+  size_t next = current;
+  if (frames_missed >= sustain_frames && current + 1 < variants.size()) {
+    next = current + 1;
+  } else if (frames_headroom >= sustain_frames) {
+    next = current - 1;
+  }
+  if (next != current) {
+    current = next;
+    have_latency = false;
+    frames_missed = 0;
+    frames_headroom = 0;
+  }
+  return current;
+}
+
+size_t Governor::get_current(void) const { return current; }
+
+const std::vector<Variant>& Governor::get_variants(void) const {
+  return variants;
+}
+
+double latency_budget(double frame_delay_ms, uint64_t frames_in_flight) {
+  return frame_delay_ms * frames_in_flight;
+}
+
+}  // namespace QoS
@@ -0,0 +1,166 @@
+/**
+ * @file qos_governor.h
+ * @brief Switches between variants of the model to keep the latency of frames
+ * within the frame rate's budget
+ *
+ * @copyright Copyright (C) 2021  Miklas Riechmann
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef SRC_QOS_GOVERNOR_H_
+#define SRC_QOS_GOVERNOR_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+/**
+ * @brief Number of consecutive frames the budget must be missed, or have
+ * headroom, for before switching variant
+ *
+ */
+#define QOS_SUSTAIN_FRAMES 10
+
+/**
+ * @brief Step up to a more expensive variant only if its latency is predicted
+ * to be within this fraction of the budget
+ *
+ * Well below 1 so that the governor does not step straight back down
+ *
+ */
+#define QOS_HEADROOM 0.7
+
+/**
+ * @brief Weight of each frame in the smoothed latency
+ *
+ */
+#define QOS_SMOOTHING 0.2
+
+/**
+ * @brief Quality of service: trading the precision of the results for
+ * keeping up with the frame rate
+ *
+ */
+namespace QoS {
+
+/**
+ * @brief A model, and the resolution to run it at
+ *
+ */
+struct Variant {
+  std::string model_filename;  ///< Path to the TensorFlow Lite model
+  size_t input_width;          ///< Width of the model's input in pixels
+  size_t input_height;         ///< Height of the model's input in pixels
+
+  /**
+   * @brief Cost of running the model once, e.g. its number of operations.
+   * Only the ratios between variants matter
+   *
+   */
+  double cost;
+};
+
+/**
+ * @brief Chooses the variant of the model to run from the measured latency of
+ * each frame
+ *
+ * Steps down to the next cheaper variant once the smoothed latency has been
+ * over the budget for `sustain_frames` consecutive frames. Steps back up once
+ * the latency, scaled by the cost of the next more expensive variant, has been
+ * within `headroom` of the budget for as long. A single slow frame therefore
+ * never causes a switch, and neither does a variant that would only just fit.
+ *
+ * After each switch the latency is measured afresh, so only frames run by the
+ * new variant should be passed to `update()`.
+ *
+ * Not thread safe.
+ *
+ */
+class Governor {
+ private:
+  std::vector<Variant> variants;
+  uint64_t sustain_frames;
+  double headroom;
+  double smoothing;
+
+  size_t current = 0;
+  bool have_latency = false;
+  double latency_ms;  ///< Smoothed latency of the `current` variant
+
+  uint64_t frames_missed = 0;    ///< Consecutive frames over the budget
+  uint64_t frames_headroom = 0;  ///< Consecutive frames with headroom
+
+ public:
+  /**
+   * @brief Construct a new `Governor` object, starting at the most expensive
+   * variant
+   *
+   * @param variants Variants to choose from, from the most to the least
+   * expensive
+   * @param sustain_frames Number of consecutive frames after which to switch
+   * @param headroom Fraction of the budget a more expensive variant must be
+   * predicted to stay within
+   * @param smoothing Weight of each frame in the smoothed latency, in (0..1]
+   * @throw `std::invalid_argument` if there are no variants, they are not in
+   * order of decreasing cost, or a cost is not positive
+   */
+  explicit Governor(std::vector<Variant> variants,
+                    uint64_t sustain_frames = QOS_SUSTAIN_FRAMES,
+                    double headroom = QOS_HEADROOM,
+                    double smoothing = QOS_SMOOTHING);
+
+  /**
+   * @brief Account for the latency of a frame, and choose the variant to run
+   * the following frames with
+   *
+   * @param latency_ms Latency of a frame run by the current variant in ms
+   * @param budget_ms Latency to keep within in ms, see `latency_budget()`
+   * @return `size_t` Index of the variant to run, which differs from before if
+   * the governor switched
+   */
+  size_t update(double latency_ms, double budget_ms);
+
+  /**
+   * @brief Get the index of the variant to run
+   *
+   */
+  size_t get_current(void) const;
+
+  /**
+   * @brief Get the variants, from the most to the least expensive
+   *
+   */
+  const std::vector<Variant>& get_variants(void) const;
+};
+
+/**
+ * @brief Latency of each frame that a pipeline can sustain at a frame rate
+ *
+ * Frames are processed in parallel, so each one may take as long as the
+ * pipeline takes to start on all the others in flight before it falls behind.
+ *
+ * @param frame_delay_ms Delay between two frames in ms
+ * @param frames_in_flight Number of frames processed at once, i.e., the
+ * number of inference cores times their batch size
+ * @return `double` Budget in ms, to pass to `Governor::update()`
+ */
+double latency_budget(double frame_delay_ms, uint64_t frames_in_flight);
+
+}  // namespace QoS
+
+#endif  // SRC_QOS_GOVERNOR_H_
@@ -0,0 +1,256 @@
+/**
+ * @copyright Copyright (C) 2021  Miklas Riechmann
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "resample.h"
+
+#include <math.h>
+
+#include <stdexcept>
+
+#define INTERPOLATION_BITS 11  ///< Precision of the weights, as in OpenCV
+#define INTERPOLATION_ONE (1 << INTERPOLATION_BITS)
+
+// BT.601 coefficients in fixed point, as used by `cv::cvtColor()`
+#define YUV_SHIFT 20
+#define YUV_CY 1220542
+#define YUV_CUB 2116026
+#define YUV_CUG -409993
+#define YUV_CVG -852492
+#define YUV_CVR 1673527
+
+namespace PreProcessing {
+
+/**
+ * @brief Interpolate between four pixels
+ *
+ */
+static inline uint8_t interpolate(uint32_t top_left, uint32_t top_right,
+                                  uint32_t bottom_left, uint32_t bottom_right,
+                                  uint32_t right_weight,
+                                  uint32_t bottom_weight) {
+  uint32_t left_weight = INTERPOLATION_ONE - right_weight;
+  uint32_t top_weight = INTERPOLATION_ONE - bottom_weight;
+  uint32_t upper = top_left * left_weight + top_right * right_weight;
+  uint32_t lower = bottom_left * left_weight + bottom_right * right_weight;
+  // Both weights are applied, so round off twice their precision
+  return (upper * top_weight + lower * bottom_weight +
+          (1 << (2 * INTERPOLATION_BITS - 1))) >>
+         (2 * INTERPOLATION_BITS);
+}
+
+static inline uint8_t clamp(int value) {
+  return value < 0 ? 0 : (value > 255 ? 255 : value);
+}
+
+/**
+ * @brief Convert a single YUV pixel to BGR, or RGB if `rgb`
+ *
+ */
+static inline void yuv_to_bgr(int y, int u, int v, uint8_t* out, bool rgb) {
+  int luma = (y > 16 ? y - 16 : 0) * YUV_CY;
+  u -= 128;
+  v -= 128;
+  const int round = 1 << (YUV_SHIFT - 1);
+  uint8_t red = clamp((luma + round + YUV_CVR * v) >> YUV_SHIFT);
+  uint8_t green =
+      clamp((luma + round + YUV_CVG * v + YUV_CUG * u) >> YUV_SHIFT);
+  uint8_t blue = clamp((luma + round + YUV_CUB * u) >> YUV_SHIFT);
+  out[0] = rgb ? red : blue;
+  out[1] = green;
+  out[2] = rgb ? blue : red;
+}
+
+/**
+ * @brief Map each of `dst_size` output positions onto the `src_size` input
+ * pixels starting at `offset`
+ *
+ * Pixel centres are aligned as in `cv::resize()`, and positions beyond the
+ * edge of the input are clamped to it.
+ *
+ * @param taps Resized to `dst_size`, which only allocates the first time
+ */
+void Resampler::compute_taps(size_t offset, size_t src_size, size_t dst_size,
+                             std::vector<Tap>* taps) {
+  taps->resize(dst_size);
+  double ratio = static_cast<double>(src_size) / dst_size;
+  for (size_t d = 0; d < dst_size; d++) {
+    double position = (d + 0.5) * ratio - 0.5;
+    double first = floor(position);
+    double fraction = position - first;
+    if (first < 0) {
+      first = 0;
+      fraction = 0;
+    }
+    if (first >= src_size - 1) {
+      first = src_size - 1;
+      fraction = 0;
+    }
+    size_t second = fraction > 0 ? first + 1 : first;
+    taps->at(d) =
+        Tap{offset + static_cast<size_t>(first), offset + second,
+            static_cast<uint32_t>(lround(fraction * INTERPOLATION_ONE))};
+  }
+}
+
+cv::Size Resampler::frame_size(const cv::Mat& frame,
+                               FrameSource::PixelFormat format) {
+  if (format == FrameSource::NV12) {
+    // The chroma plane follows the luma plane, at half the height
+    return cv::Size(frame.cols, frame.rows * 2 / 3);
+  }
+  return frame.size();
+}
+
+void Resampler::start(const cv::Mat& frame, FrameSource::PixelFormat format,
+                      cv::Size target_size, cv::Rect region) {
+  bool valid = false;
+  switch (format) {
+    case FrameSource::BGR:
+    case FrameSource::RGB:
+      valid = frame.type() == CV_8UC3;
+      break;
+    case FrameSource::YUYV:
+      valid = frame.type() == CV_8UC2 && frame.cols % 2 == 0;
+      break;
+    case FrameSource::NV12:
+      valid = frame.type() == CV_8UC1 && frame.cols % 2 == 0 &&
+              frame.rows % 3 == 0;
+      break;
+  }
+  if (frame.empty() || !valid) {
+    throw std::invalid_argument("Frame does not match its pixel format");
+  }
+
+  cv::Size size = frame_size(frame, format);
+  if (region.empty()) {
+    region = cv::Rect(cv::Point(0, 0), size);
+  } else if ((region & cv::Rect(cv::Point(0, 0), size)) != region) {
+    throw std::invalid_argument("Region is not within the frame");
+  }
+  if (size != source_size || region != this->region ||
+      target_size != this->target_size) {
+    // Frame sizes rarely change, so this is mostly done once per region
+    compute_taps(region.x, region.width, target_size.width, &columns);
+    compute_taps(region.y, region.height, target_size.height, &rows);
+    source_size = size;
+    this->region = region;
+    this->target_size = target_size;
+  }
+  this->frame = &frame;
+  this->format = format;
+}
+
+void Resampler::rgb_row(const Tap& row, uint8_t* out, bool swap_red_blue) {
+  const uint8_t* top = frame->ptr<uint8_t>(row.first);
+  const uint8_t* bottom = frame->ptr<uint8_t>(row.second);
+  for (const Tap& column : columns) {
+    size_t left = column.first * 3;
+    size_t right = column.second * 3;
+    for (size_t c = 0; c < 3; c++) {
+      out[swap_red_blue ? 2 - c : c] =
+          interpolate(top[left + c], top[right + c], bottom[left + c],
+                      bottom[right + c], column.weight, row.weight);
+    }
+    out += 3;
+  }
+}
+
+void Resampler::yuyv_row(const Tap& row, uint8_t* out, bool rgb) {
+  // Each pair of pixels is stored as Y0 U Y1 V
+  const uint8_t* top = frame->ptr<uint8_t>(row.first);
+  const uint8_t* bottom = frame->ptr<uint8_t>(row.second);
+  for (const Tap& column : columns) {
+    size_t left = column.first * 2;
+    size_t right = column.second * 2;
+    size_t left_pair = (column.first & ~1) * 2;
+    size_t right_pair = (column.second & ~1) * 2;
+
+    uint8_t y = interpolate(top[left], top[right], bottom[left],
+                            bottom[right], column.weight, row.weight);
+    uint8_t u = interpolate(top[left_pair + 1], top[right_pair + 1],
+                            bottom[left_pair + 1], bottom[right_pair + 1],
+                            column.weight, row.weight);
+    uint8_t v = interpolate(top[left_pair + 3], top[right_pair + 3],
+                            bottom[left_pair + 3], bottom[right_pair + 3],
+                            column.weight, row.weight);
+    yuv_to_bgr(y, u, v, out, rgb);
+    out += 3;
+  }
+}
+
+void Resampler::nv12_row(const Tap& row, uint8_t* out, bool rgb) {
+  // A full size luma plane followed by interleaved U V at half the size
+  const uint8_t* top = frame->ptr<uint8_t>(row.first);
+  const uint8_t* bottom = frame->ptr<uint8_t>(row.second);
+  const uint8_t* top_chroma =
+      frame->ptr<uint8_t>(source_size.height + row.first / 2);
+  const uint8_t* bottom_chroma =
+      frame->ptr<uint8_t>(source_size.height + row.second / 2);
+  for (const Tap& column : columns) {
+    size_t left = column.first;
+    size_t right = column.second;
+    size_t left_pair = column.first & ~1;
+    size_t right_pair = column.second & ~1;
+
+    uint8_t y = interpolate(top[left], top[right], bottom[left],
+                            bottom[right], column.weight, row.weight);
+    uint8_t u = interpolate(top_chroma[left_pair], top_chroma[right_pair],
+                            bottom_chroma[left_pair],
+                            bottom_chroma[right_pair], column.weight,
+                            row.weight);
+    uint8_t v =
+        interpolate(top_chroma[left_pair + 1], top_chroma[right_pair + 1],
+                    bottom_chroma[left_pair + 1],
+                    bottom_chroma[right_pair + 1], column.weight, row.weight);
+    yuv_to_bgr(y, u, v, out, rgb);
+    out += 3;
+  }
+}
+
+void Resampler::row(size_t y, uint8_t* out,
+                    FrameSource::PixelFormat output_format) {
+  bool rgb = output_format == FrameSource::RGB;
+  switch (format) {
+    case FrameSource::BGR:
+      rgb_row(rows[y], out, rgb);
+      break;
+    case FrameSource::RGB:
+      rgb_row(rows[y], out, !rgb);
+      break;
+    case FrameSource::YUYV:
+      yuyv_row(rows[y], out, rgb);
+      break;
+    case FrameSource::NV12:
+      nv12_row(rows[y], out, rgb);
+      break;
+  }
+}
+
+cv::Mat Resampler::resample(const cv::Mat& frame,
+                            FrameSource::PixelFormat format,
+                            cv::Size target_size,
+                            FrameSource::PixelFormat output_format) {
+  start(frame, format, target_size);
+  cv::Mat resampled(target_size, CV_8UC3);
+  for (int y = 0; y < target_size.height; y++) {
+    row(y, resampled.ptr<uint8_t>(y), output_format);
+  }
+  return resampled;
+}
+
+}  // namespace PreProcessing
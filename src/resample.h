@@ -0,0 +1,128 @@
+/**
+ * @file resample.h
+ * @brief Resizing and colour conversion of frames in a single pass
+ *
+ * @copyright Copyright (C) 2021  Miklas Riechmann
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef SRC_RESAMPLE_H_
+#define SRC_RESAMPLE_H_
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "frame_source.h"
+#include "opencv2/core.hpp"
+
+namespace PreProcessing {
+
+/**
+ * @brief Resizes a frame in any `FrameSource::PixelFormat` to 8-bit BGR or
+ * RGB, one output row at a time
+ *
+ * Resizing uses bilinear interpolation, like `cv::resize()` with
+ * `cv::INTER_LINEAR`. YUV frames are interpolated in YUV and only converted
+ * to RGB at the target size, so a camera's native format never has to be
+ * converted at full resolution. The result matches converting with
+ * `cv::cvtColor()` and then resizing, give or take rounding.
+ *
+ * The interpolation tables are kept between frames and only recomputed when
+ * the frame or target size changes, so resampling does not allocate.
+ *
+ */
+class Resampler {
+ private:
+  /**
+   * @brief The two source pixels an output pixel is interpolated from, along
+   * one axis
+   *
+   */
+  struct Tap {
+    size_t first;
+    size_t second;
+    uint32_t weight;  ///< Of `second`, out of `INTERPOLATION_ONE`
+  };
+
+  const cv::Mat* frame = nullptr;  ///< Not owned, see `start()`
+  FrameSource::PixelFormat format = FrameSource::BGR;
+  cv::Size source_size;  ///< Size of the frame in pixels
+  cv::Rect region;       ///< Part of the frame that is resampled
+  cv::Size target_size;
+  std::vector<Tap> columns;
+  std::vector<Tap> rows;
+
+  static void compute_taps(size_t offset, size_t src_size, size_t dst_size,
+                           std::vector<Tap>* taps);
+
+  void rgb_row(const Tap& row, uint8_t* out, bool swap_red_blue);
+  void yuyv_row(const Tap& row, uint8_t* out, bool rgb);
+  void nv12_row(const Tap& row, uint8_t* out, bool rgb);
+
+ public:
+  /**
+   * @brief Get the size in pixels of a frame
+   *
+   * Differs from `frame.size()` for formats with more than one plane
+   *
+   */
+  static cv::Size frame_size(const cv::Mat& frame,
+                             FrameSource::PixelFormat format);
+
+  /**
+   * @brief Start resampling a frame
+   *
+   * @param frame Frame to resample. Not copied, so must outlive all calls of
+   * `row()` that follow
+   * @param format Pixel format of `frame`
+   * @param target_size Size to resize to
+   * @param region Part of the frame to resize, in pixels. Empty for the whole
+   * frame
+   * @throw `std::invalid_argument` if `frame` does not hold an image in
+   * `format`, or `region` is not within it
+   */
+  void start(const cv::Mat& frame, FrameSource::PixelFormat format,
+             cv::Size target_size, cv::Rect region = cv::Rect());
+
+  /**
+   * @brief Write a row of the resized frame
+   *
+   * @param y Row of the resized frame, less than the target height
+   * @param out Output for target width * 3 bytes
+   * @param output_format Either `FrameSource::BGR` or `FrameSource::RGB`
+   */
+  void row(size_t y, uint8_t* out, FrameSource::PixelFormat output_format);
+
+  /**
+   * @brief Resample a whole frame
+   *
+   * @param frame Frame to resample
+   * @param format Pixel format of `frame`
+   * @param target_size Size to resize to
+   * @param output_format Either `FrameSource::BGR` or `FrameSource::RGB`
+   * @return `cv::Mat` Newly allocated 8-bit 3 channel image
+   * @throw `std::invalid_argument` if `frame` does not hold an image in
+   * `format`
+   */
+  cv::Mat resample(const cv::Mat& frame, FrameSource::PixelFormat format,
+                   cv::Size target_size,
+                   FrameSource::PixelFormat output_format);
+};
+
+}  // namespace PreProcessing
+
+#endif  // SRC_RESAMPLE_H_
@@ -0,0 +1,80 @@
+/**
+ * @copyright Copyright (C) 2021  Miklas Riechmann
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "roi_tracker.h"
+
+#include <algorithm>
+
+namespace PreProcessing {
+
+RoiTracker::RoiTracker(float margin, uint64_t reacquire_period)
+    : margin(margin),
+      reacquire_period(reacquire_period),
+      region(Region{0, 0, 1, 1}) {}
+
+Region RoiTracker::next(void) {
+  std::lock_guard<std::mutex> lock(mutex);
+  frames++;
+  if (!tracking || frames >= reacquire_period) {
+    frames = 0;
+    return Region{0, 0, 1, 1};
+  }
+  return region;
+}
+
+void RoiTracker::update(const PostProcessing::ProcessedResults& results) {
+  float left = 1;
+  float top = 1;
+  float right = 0;
+  float bottom = 0;
+  int joints = 0;
+  for (auto& joint : results.body_parts) {
+    if (joint.status == PostProcessing::Trustworthy) {
+      left = std::min(left, joint.x);
+      top = std::min(top, joint.y);
+      right = std::max(right, joint.x);
+      bottom = std::max(bottom, joint.y);
+      joints++;
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(mutex);
+  tracking = joints >= ROI_MIN_JOINTS;
+  if (!tracking) {
+    return;
+  }
+
+  // Square about the centre of the bounding box, and within the frame
+  float size = std::max(right - left, bottom - top) * (1 + 2 * margin);
+  size = std::min(std::max(size, static_cast<float>(ROI_MIN_SIZE)), 1.0f);
+  float x = (left + right - size) / 2;
+  float y = (top + bottom - size) / 2;
+  region = Region{std::min(std::max(x, 0.0f), 1 - size),
+                  std::min(std::max(y, 0.0f), 1 - size), size, size};
+}
+
+Inference::InferenceResults RoiTracker::to_frame(
+    Region region, Inference::InferenceResults results) {
+  for (auto& body_part : results.body_parts) {
+    body_part.x = region.x + body_part.x * region.width;
+    body_part.y = region.y + body_part.y * region.height;
+  }
+  return results;
+}
+
+}  // namespace PreProcessing
@@ -0,0 +1,129 @@
+/**
+ * @file roi_tracker.h
+ * @brief Crop frames around the user before they are passed to the model
+ *
+ * @copyright Copyright (C) 2021  Miklas Riechmann
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef SRC_ROI_TRACKER_H_
+#define SRC_ROI_TRACKER_H_
+
+#include <stdint.h>
+
+#include <mutex>  //NOLINT [build/c++11]
+
+#include "intermediate_structures.h"
+
+/**
+ * @brief Margin added on each side of the user's bounding box, as a fraction
+ * of its size
+ *
+ */
+#define ROI_MARGIN 0.25
+
+/**
+ * @brief Smallest region to crop to, as a fraction of the frame
+ *
+ * Stops a few badly placed joints from zooming in on a tiny part of the frame
+ *
+ */
+#define ROI_MIN_SIZE 0.3
+
+/**
+ * @brief Number of frames after which a whole frame is processed again, in
+ * case the user has moved out of the region
+ *
+ */
+#define ROI_REACQUIRE_PERIOD 30
+
+/**
+ * @brief Minimum number of `PostProcessing::Trustworthy` joints needed to track
+ * the user
+ *
+ */
+#define ROI_MIN_JOINTS 2
+
+namespace PreProcessing {
+
+/**
+ * @brief Chooses the region of each frame to pass to the model
+ *
+ * The user normally takes up a small part of the frame, so resizing the whole
+ * frame to the model's input wastes most of its resolution. Instead, frames
+ * are cropped to the user's bounding box in the last `ProcessedResults`, plus
+ * a margin. Every `reacquire_period` frames, and whenever too few joints are
+ * trustworthy, the whole frame is used instead so that the user is found again
+ * after moving.
+ *
+ * Regions are square relative to the frame, so the model sees the same aspect
+ * ratio as when it is given whole frames.
+ *
+ * Thread safe: `next()` is called by the inference core threads and `update()`
+ * by the post processing thread.
+ *
+ */
+class RoiTracker {
+ private:
+  float margin;
+  uint64_t reacquire_period;
+
+  std::mutex mutex;
+  Region region;          ///< Region around the user, protected by `mutex`
+  bool tracking = false;  ///< Whether `region` holds the user
+  uint64_t frames = 0;    ///< Frames since the whole frame was last used
+
+ public:
+  /**
+   * @brief Construct a new `RoiTracker` object
+   *
+   * @param margin Margin added on each side of the user's bounding box, as a
+   * fraction of its size
+   * @param reacquire_period Number of frames after which a whole frame is
+   * used again. 1 always uses the whole frame
+   */
+  explicit RoiTracker(float margin = ROI_MARGIN,
+                      uint64_t reacquire_period = ROI_REACQUIRE_PERIOD);
+
+  /**
+   * @brief Get the region of the next frame to pass to the model
+   *
+   * @return `Region` The whole frame or the region around the user
+   */
+  Region next(void);
+
+  /**
+   * @brief Update the region around the user
+   *
+   * @param results The latest results, relative to the whole frame
+   */
+  void update(const PostProcessing::ProcessedResults& results);
+
+  /**
+   * @brief Map results of running the model on a region back onto the whole
+   * frame
+   *
+   * @param region The region the model was given
+   * @param results Results relative to `region`
+   * @return `Inference::InferenceResults` Results relative to the whole frame
+   */
+  static Inference::InferenceResults to_frame(
+      Region region, Inference::InferenceResults results);
+};
+
+}  // namespace PreProcessing
+
+#endif  // SRC_ROI_TRACKER_H_
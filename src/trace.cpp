@@ -0,0 +1,173 @@
+/**
+ * @copyright Copyright (C) 2021  Miklas Riechmann
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "trace.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+
+#include <atomic>
+#include <mutex>  //NOLINT [build/c++11]
+#include <utility>
+#include <vector>
+
+namespace Trace {
+
+/**
+ * @brief A single recorded event
+ *
+ */
+struct Event {
+  const char* name;
+  char phase;  ///< `X` for a stage with a duration, `i` for an instant
+  uint64_t frame;
+  uint32_t tid;
+  Clock::time_point start;
+  Clock::time_point end;
+};
+
+static std::atomic<bool> recording(false);
+static std::mutex mutex;  ///< Protects everything below
+static std::vector<Event> events;
+static std::vector<std::pair<uint32_t, const char*>> thread_names;
+static std::string trace_path;
+static Clock::time_point session_start;
+
+static std::atomic<uint32_t> next_thread_id(1);
+static thread_local uint32_t this_thread_id = 0;
+static thread_local uint64_t this_thread_frame = 0;
+
+static void record(Event event) {
+  std::unique_lock<std::mutex> lock(mutex);
+  if (events.size() < TRACE_MAX_EVENTS) {
+    events.push_back(event);
+  }
+}
+
+/**
+ * @brief Time from the start of the session in µs, as Chrome expects
+ *
+ */
+static double to_us(Clock::time_point time) {
+  return std::chrono::duration<double, std::micro>(time - session_start)
+      .count();
+}
+
+bool start(std::string path) {
+  std::unique_lock<std::mutex> lock(mutex);
+  if (recording) {
+    return false;
+  }
+  events.clear();
+  trace_path = path;
+  session_start = Clock::now();
+  recording = true;
+  return true;
+}
+
+bool stop(void) {
+  std::unique_lock<std::mutex> lock(mutex);
+  if (!recording) {
+    return false;
+  }
+  recording = false;
+
+  FILE* file = fopen(trace_path.c_str(), "w");
+  if (file == NULL) {
+    fprintf(stderr, "Cannot write trace to %s\n", trace_path.c_str());
+    return false;
+  }
+
+  fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+  const char* separator = "";
+  for (auto& thread_name : thread_names) {
+    fprintf(file,
+            "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,"
+            "\"args\":{\"name\":\"%s\"}}",
+            separator, thread_name.first, thread_name.second);
+    separator = ",\n";
+  }
+  for (auto& event : events) {
+    fprintf(file,
+            "%s{\"name\":\"%s\",\"ph\":\"%c\",\"pid\":1,\"tid\":%u,"
+            "\"ts\":%.3f,",
+            separator, event.name, event.phase, event.tid,
+            to_us(event.start));
+    if (event.phase == 'X') {
+      fprintf(file, "\"dur\":%.3f,", to_us(event.end) - to_us(event.start));
+    } else {
+      fprintf(file, "\"s\":\"t\",");
+    }
+    fprintf(file, "\"args\":{\"frame\":%" PRIu64 "}}", event.frame);
+    separator = ",\n";
+  }
+  fprintf(file, "\n]}\n");
+  fclose(file);
+
+  printf("Wrote %zu trace events to %s\n", events.size(), trace_path.c_str());
+  events.clear();
+  return true;
+}
+
+bool enabled(void) { return recording; }
+
+uint32_t thread_id(void) {
+  if (this_thread_id == 0) {
+    this_thread_id = next_thread_id++;
+  }
+  return this_thread_id;
+}
+
+void name_thread(const char* name) {
+  std::unique_lock<std::mutex> lock(mutex);
+  thread_names.push_back(std::make_pair(thread_id(), name));
+}
+
+void set_frame(uint64_t frame) { this_thread_frame = frame; }
+
+uint64_t frame(void) { return this_thread_frame; }
+
+void complete(const char* name, uint64_t frame, Clock::time_point start,
+              Clock::time_point end, uint32_t tid) {
+  // `start` is zero if it was taken while not recording
+  if (recording && start != Clock::time_point()) {
+    record(Event{name, 'X', frame, tid, start, end});
+  }
+}
+
+void instant(const char* name, uint64_t frame) {
+  if (recording) {
+    auto now = Clock::now();
+    record(Event{name, 'i', frame, thread_id(), now, now});
+  }
+}
+
+Span::Span(const char* name, uint64_t frame)
+    : name(name), frame(frame), active(recording) {
+  if (active) {
+    start = Clock::now();
+  }
+}
+
+Span::~Span() {
+  if (active) {
+    complete(name, frame, start, Clock::now());
+  }
+}
+
+}  // namespace Trace
@@ -0,0 +1,169 @@
+/**
+ * @file trace.h
+ * @brief Timing of every stage a frame passes through, for Chrome's trace
+ * viewer or Perfetto
+ *
+ * @copyright Copyright (C) 2021  Miklas Riechmann
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef SRC_TRACE_H_
+#define SRC_TRACE_H_
+
+#include <stdint.h>
+
+#include <chrono>  //NOLINT [build/c++11]
+#include <string>
+
+#define TRACE_MAX_EVENTS 1000000  ///< Events beyond this are not recorded
+
+/**
+ * @brief Record when each frame enters and leaves each stage of the pipeline
+ *
+ * Code is instrumented with the `TRACE_*` macros below. These only do
+ * anything if the project is built with `-DENABLE_TRACING=True`, and even then
+ * events are only recorded between `Trace::start()` and `Trace::stop()`.
+ * Without the build flag the macros compile to nothing.
+ *
+ * Every event carries the ID of the frame it belongs to, so a single frame can
+ * be followed from capture to display. `Trace::stop()` writes the events in
+ * Chrome's JSON trace format, which can be opened in `chrome://tracing` or
+ * <a href="https://ui.perfetto.dev">Perfetto</a>.
+ *
+ */
+namespace Trace {
+
+typedef std::chrono::steady_clock Clock;
+
+/**
+ * @brief Start recording events
+ *
+ * @param path File to write the trace to once `stop()` is called
+ * @return `true` If recording started
+ * @return `false` If already recording
+ */
+bool start(std::string path);
+
+/**
+ * @brief Stop recording and write all events recorded since `start()`
+ *
+ * @return `true` If the trace was written
+ * @return `false` If not recording or the file could not be written
+ */
+bool stop(void);
+
+/**
+ * @brief Check if events are currently being recorded
+ *
+ */
+bool enabled(void);
+
+/**
+ * @brief Small number identifying the calling thread in the trace
+ *
+ */
+uint32_t thread_id(void);
+
+/**
+ * @brief Name the calling thread in the trace
+ *
+ * @param name Must be a string literal, or otherwise outlive the recording
+ */
+void name_thread(const char* name);
+
+/**
+ * @brief Set the frame the calling thread is working on
+ *
+ * Lets code that does not know about frame IDs, such as the inference core,
+ * label its events with the right frame.
+ *
+ */
+void set_frame(uint64_t frame);
+
+/**
+ * @brief Get the frame set by the last `set_frame()` on this thread
+ *
+ */
+uint64_t frame(void);
+
+/**
+ * @brief Record that `frame` spent the time from `start` to `end` in the stage
+ * `name`
+ *
+ * @param name Must be a string literal, or otherwise outlive the recording
+ * @param frame ID of the frame
+ * @param start Time the stage started
+ * @param end Time the stage ended
+ * @param tid Thread to show the event on
+ */
+void complete(const char* name, uint64_t frame, Clock::time_point start,
+              Clock::time_point end, uint32_t tid = thread_id());
+
+/**
+ * @brief Record that `frame` passed the point `name` now
+ *
+ * @param name Must be a string literal, or otherwise outlive the recording
+ * @param frame ID of the frame
+ */
+void instant(const char* name, uint64_t frame);
+
+/**
+ * @brief Records the time from its construction to its destruction as a stage
+ *
+ */
+class Span {
+ private:
+  const char* name;
+  uint64_t frame;
+  Clock::time_point start;
+  bool active;
+
+ public:
+  Span(const char* name, uint64_t frame);
+  ~Span();
+};
+
+}  // namespace Trace
+
+#ifdef ENABLE_TRACING
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+
+/// Record the rest of the enclosing scope as stage `name` of `frame`
+#define TRACE_SPAN(name, frame) \
+  Trace::Span TRACE_CONCAT(trace_span_, __LINE__)(name, frame)
+/// See `Trace::instant()`
+#define TRACE_INSTANT(name, frame) Trace::instant(name, frame)
+/// See `Trace::complete()`
+#define TRACE_COMPLETE(name, frame, start, end, tid) \
+  Trace::complete(name, frame, start, end, tid)
+/// See `Trace::set_frame()`
+#define TRACE_SET_FRAME(frame) Trace::set_frame(frame)
+/// See `Trace::name_thread()`
+#define TRACE_THREAD_NAME(name) Trace::name_thread(name)
+/// The current time, if recording
+#define TRACE_NOW() \
+  (Trace::enabled() ? Trace::Clock::now() : Trace::Clock::time_point())
+#else
+#define TRACE_SPAN(name, frame)
+#define TRACE_INSTANT(name, frame)
+#define TRACE_COMPLETE(name, frame, start, end, tid)
+#define TRACE_SET_FRAME(frame)
+#define TRACE_THREAD_NAME(name)
+#define TRACE_NOW() Trace::Clock::time_point()
+#endif
+
+#endif  // SRC_TRACE_H_
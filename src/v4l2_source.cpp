@@ -0,0 +1,303 @@
+/**
+ * @copyright Copyright (C) 2021  Miklas Riechmann
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "v4l2_source.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/videodev2.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <stdexcept>
+
+namespace FrameSource {
+
+/**
+ * @brief `ioctl()` that is retried if interrupted by a signal
+ *
+ */
+static int xioctl(int fd, unsigned long request, void* arg) {  // NOLINT
+  int result;
+  do {
+    result = ioctl(fd, request, arg);
+  } while (result == -1 && errno == EINTR);
+  return result;
+}
+
+V4L2Source::Device::Device(std::string path, uint32_t width, uint32_t height) {
+  fd = open(path.c_str(), O_RDWR);
+  if (fd < 0) {
+    throw std::runtime_error("Cannot open " + path + ": " + strerror(errno));
+  }
+
+  try {
+    v4l2_capability capability;
+    memset(&capability, 0, sizeof(capability));
+    if (xioctl(fd, VIDIOC_QUERYCAP, &capability) < 0) {
+      throw std::runtime_error(path + " is not a V4L2 device");
+    }
+    uint32_t caps = (capability.capabilities & V4L2_CAP_DEVICE_CAPS)
+                        ? capability.device_caps
+                        : capability.capabilities;
+    if (!(caps & V4L2_CAP_VIDEO_CAPTURE) || !(caps & V4L2_CAP_STREAMING)) {
+      throw std::runtime_error(path + " cannot stream video");
+    }
+
+    // Prefer the YUV formats cameras produce natively, so that nothing is
+    // converted at full resolution; YUYV is supported by nearly every webcam
+    v4l2_format format;
+    uint32_t pixel_formats[] = {V4L2_PIX_FMT_YUYV, V4L2_PIX_FMT_NV12,
+                                V4L2_PIX_FMT_BGR24};
+    bool negotiated = false;
+    // Drivers substitute a format they do support rather than fail, in which
+    // case there is no error to report
+    int error = 0;
+    for (auto requested : pixel_formats) {
+      memset(&format, 0, sizeof(format));
+      format.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+      format.fmt.pix.width = width;
+      format.fmt.pix.height = height;
+      format.fmt.pix.pixelformat = requested;
+      format.fmt.pix.field = V4L2_FIELD_NONE;
+      if (xioctl(fd, VIDIOC_S_FMT, &format) < 0) {
+        error = errno;
+      } else if (format.fmt.pix.pixelformat == requested) {
+        negotiated = true;
+        break;
+      }
+    }
+    if (!negotiated) {
+      throw std::runtime_error(
+          "Cannot set " + path + " to any of YUYV, NV12 or BGR24" +
+          (error != 0 ? std::string(": ") + strerror(error) : ""));
+    }
+    pixel_format = format.fmt.pix.pixelformat;
+    if (pixel_format == V4L2_PIX_FMT_YUYV) {
+      frame_format = YUYV;
+      frame_type = CV_8UC2;
+      frame_rows = format.fmt.pix.height;
+    } else if (pixel_format == V4L2_PIX_FMT_NV12) {
+      // Both planes in a single `cv::Mat`, see `FrameSource::NV12`
+      frame_format = NV12;
+      frame_type = CV_8UC1;
+      frame_rows = format.fmt.pix.height * 3 / 2;
+    } else {
+      frame_format = BGR;
+      frame_type = CV_8UC3;
+      frame_rows = format.fmt.pix.height;
+    }
+    this->width = format.fmt.pix.width;
+    this->height = format.fmt.pix.height;
+    bytes_per_line = format.fmt.pix.bytesperline;
+
+    v4l2_requestbuffers request;
+    memset(&request, 0, sizeof(request));
+    request.count = V4L2_NUM_BUFFERS;
+    request.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    request.memory = V4L2_MEMORY_MMAP;
+    if (xioctl(fd, VIDIOC_REQBUFS, &request) < 0 ||
+        request.count <= V4L2_MIN_QUEUED_BUFFERS) {
+      throw std::runtime_error("Cannot allocate buffers for " + path);
+    }
+
+    for (uint32_t i = 0; i < request.count; i++) {
+      v4l2_buffer buffer;
+      memset(&buffer, 0, sizeof(buffer));
+      buffer.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+      buffer.memory = V4L2_MEMORY_MMAP;
+      buffer.index = i;
+      if (xioctl(fd, VIDIOC_QUERYBUF, &buffer) < 0) {
+        throw std::runtime_error("Cannot query buffers of " + path);
+      }
+      void* start = mmap(NULL, buffer.length, PROT_READ | PROT_WRITE,
+                         MAP_SHARED, fd, buffer.m.offset);
+      if (start == MAP_FAILED) {
+        throw std::runtime_error("Cannot map buffers of " + path);
+      }
+      buffers.push_back(
+          MappedBuffer{reinterpret_cast<uint8_t*>(start), buffer.length});
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    for (uint32_t i = 0; i < buffers.size(); i++) {
+      queue(i);
+    }
+    lock.unlock();
+
+    v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    if (xioctl(fd, VIDIOC_STREAMON, &type) < 0) {
+      throw std::runtime_error("Cannot start streaming from " + path);
+    }
+  } catch (...) {
+    // The destructor does not run if the constructor throws
+    for (auto& buffer : buffers) {
+      munmap(buffer.start, buffer.length);
+    }
+    ::close(fd);
+    throw;
+  }
+}
+
+V4L2Source::Device::~Device() {
+  for (auto& buffer : buffers) {
+    munmap(buffer.start, buffer.length);
+  }
+  ::close(fd);
+}
+
+void V4L2Source::Device::queue(uint32_t index) const {
+  v4l2_buffer buffer;
+  memset(&buffer, 0, sizeof(buffer));
+  buffer.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+  buffer.memory = V4L2_MEMORY_MMAP;
+  buffer.index = index;
+  if (xioctl(fd, VIDIOC_QBUF, &buffer) < 0) {
+    fprintf(stderr, "Cannot requeue V4L2 buffer %u: %s\n", index,
+            strerror(errno));
+    return;
+  }
+  queued++;
+}
+
+bool V4L2Source::Device::grab(void) {
+  std::unique_lock<std::mutex> lock(mutex);
+  if (grabbed >= 0) {
+    // The previous frame was never retrieved
+    queue(grabbed);
+    grabbed = -1;
+  }
+  lock.unlock();
+
+  v4l2_buffer buffer;
+  memset(&buffer, 0, sizeof(buffer));
+  buffer.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+  buffer.memory = V4L2_MEMORY_MMAP;
+  if (xioctl(fd, VIDIOC_DQBUF, &buffer) < 0) {
+    return false;
+  }
+
+  lock.lock();
+  queued--;
+  if (buffer.flags & V4L2_BUF_FLAG_ERROR) {
+    queue(buffer.index);
+    return false;
+  }
+  grabbed = buffer.index;
+  return true;
+}
+
+bool V4L2Source::Device::retrieve(cv::Mat* frame) {
+  // Release whatever `frame` held first, so that a previous frame is never
+  // written into while others still use it. This may lock `mutex`
+  frame->release();
+
+  std::unique_lock<std::mutex> lock(mutex);
+  if (grabbed < 0) {
+    return false;
+  }
+  uint32_t index = grabbed;
+  grabbed = -1;
+  bool copy = queued < V4L2_MIN_QUEUED_BUFFERS;
+  if (!copy) {
+    outstanding++;
+  }
+  lock.unlock();
+
+  uint8_t* start = buffers.at(index).start;
+  if (copy) {
+    cv::Mat(frame_rows, width, frame_type, start, bytes_per_line)
+        .copyTo(*frame);
+  } else {
+    // Wrap the buffer so that OpenCV reference counts it and calls
+    // `deallocate()` once the last `cv::Mat` using it is released
+    cv::UMatData* u = new cv::UMatData(this);
+    u->data = u->origdata = start;
+    u->size = buffers.at(index).length;
+    u->userdata = reinterpret_cast<void*>(static_cast<uintptr_t>(index));
+    u->refcount = 1;
+
+    cv::Mat wrapped(frame_rows, width, frame_type, start, bytes_per_line);
+    wrapped.u = u;
+    *frame = wrapped;
+    return true;
+  }
+
+  lock.lock();
+  queue(index);
+  return true;
+}
+
+void V4L2Source::Device::close(void) {
+  std::unique_lock<std::mutex> lock(mutex);
+  closed = true;
+  v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+  xioctl(fd, VIDIOC_STREAMOFF, &type);
+  queued = 0;
+  if (outstanding > 0) {
+    // The last frame to be released deletes the device
+    return;
+  }
+  lock.unlock();
+  delete this;
+}
+
+cv::UMatData* V4L2Source::Device::allocate(int, const int*, int, void*,
+                                           size_t*, cv::AccessFlag,
+                                           cv::UMatUsageFlags) const {
+  // Only used to release driver buffers; OpenCV allocates new images itself
+  return NULL;
+}
+
+bool V4L2Source::Device::allocate(cv::UMatData*, cv::AccessFlag,
+                                  cv::UMatUsageFlags) const {
+  return false;
+}
+
+void V4L2Source::Device::deallocate(cv::UMatData* data) const {
+  uint32_t index = static_cast<uint32_t>(
+      reinterpret_cast<uintptr_t>(data->userdata));
+  delete data;
+
+  std::unique_lock<std::mutex> lock(mutex);
+  outstanding--;
+  if (!closed) {
+    queue(index);
+    return;
+  }
+  if (outstanding == 0) {
+    lock.unlock();
+    delete this;
+  }
+}
+
+V4L2Source::V4L2Source(std::string path, uint32_t width, uint32_t height)
+    : device(new Device(path, width, height)) {}
+
+V4L2Source::~V4L2Source() { device->close(); }
+
+bool V4L2Source::grab(void) { return device->grab(); }
+
+bool V4L2Source::retrieve(cv::Mat* frame) { return device->retrieve(frame); }
+
+PixelFormat V4L2Source::pixel_format(void) { return device->frame_format; }
+
+}  // namespace FrameSource
@@ -0,0 +1,209 @@
+/**
+ * @file v4l2_source.h
+ * @brief Zero-copy camera capture through Video4Linux2
+ *
+ * @copyright Copyright (C) 2021  Miklas Riechmann
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef SRC_V4L2_SOURCE_H_
+#define SRC_V4L2_SOURCE_H_
+
+#include <stdint.h>
+
+#include <mutex>  //NOLINT [build/c++11]
+#include <string>
+#include <vector>
+
+#include "frame_source.h"
+#include "opencv2/core.hpp"
+
+#define V4L2_NUM_BUFFERS 6  ///< Number of buffers to request from the driver
+
+/**
+ * @brief Minimum number of buffers that must stay queued with the driver
+ *
+ * If handing out another buffer without copying would leave fewer than this
+ * for the driver to capture into, the frame is copied instead so that capture
+ * never stalls on frames held further down the pipeline.
+ *
+ */
+#define V4L2_MIN_QUEUED_BUFFERS 2
+
+namespace FrameSource {
+
+/**
+ * @brief Frames from a camera, read straight from the driver's memory mapped
+ * buffers
+ *
+ * Unlike `Camera`, frames are not copied into a newly allocated `cv::Mat`.
+ * Each frame is a `cv::Mat` header pointing at a driver buffer, and that
+ * buffer is handed back to the driver once the last copy of the header is
+ * released. Frames that are read but never used therefore cost no memory
+ * bandwidth beyond what the driver itself uses.
+ *
+ * The camera is asked for YUYV or NV12, which cameras produce natively, and
+ * frames are handed out in that format so that they are only converted to RGB
+ * once resized. BGR24 is supported for cameras that offer neither.
+ *
+ */
+class V4L2Source : public FrameSource {
+ private:
+  /**
+   * @brief Open device and its buffers
+   *
+   * This also acts as the allocator of the frames handed out, so that
+   * releasing a frame returns its buffer to the driver. It is shared between
+   * the source and the frames and deletes itself once both have released it,
+   * as frames may outlive the source.
+   *
+   */
+  class Device : public cv::MatAllocator {
+   private:
+    /**
+     * @brief A memory mapped driver buffer
+     *
+     */
+    struct MappedBuffer {
+      uint8_t* start;
+      size_t length;
+    };
+
+    /**
+     * @brief Protects everything below, as frames are released from other
+     * threads
+     *
+     */
+    mutable std::mutex mutex;
+
+    std::vector<MappedBuffer> buffers;
+
+    /**
+     * @brief Number of buffers currently queued with the driver
+     *
+     */
+    mutable size_t queued = 0;
+
+    /**
+     * @brief Frames handed out and not yet released
+     *
+     */
+    mutable size_t outstanding = 0;
+
+    /**
+     * @brief Set once the owning `V4L2Source` is destroyed
+     *
+     */
+    mutable bool closed = false;
+
+    /**
+     * @brief Index of the buffer taken from the driver by the last `grab()`,
+     * or -1 if there is none or it has been retrieved
+     *
+     */
+    int grabbed = -1;
+
+    /**
+     * @brief Hand a buffer back to the driver
+     *
+     * Must be called with `mutex` held
+     *
+     */
+    void queue(uint32_t index) const;
+
+    ~Device();
+
+   public:
+    int fd = -1;
+    uint32_t pixel_format;  ///< V4L2 FourCC
+    uint32_t width;
+    uint32_t height;
+    uint32_t bytes_per_line;
+
+    PixelFormat frame_format;  ///< `pixel_format` as a `FrameSource` format
+    int frame_type;            ///< OpenCV type of the frames
+    uint32_t frame_rows;       ///< Rows of the frames, including all planes
+
+    Device(std::string path, uint32_t width, uint32_t height);
+
+    /**
+     * @brief Take the next filled buffer from the driver, handing back the
+     * previous one if it was never retrieved
+     *
+     */
+    bool grab(void);
+
+    /**
+     * @brief Turn the grabbed buffer into a frame
+     *
+     * @param frame Set to the frame. Refers to the driver buffer if possible
+     */
+    bool retrieve(cv::Mat* frame);
+
+    /**
+     * @brief Stop capturing and delete the device once all frames are released
+     *
+     */
+    void close(void);
+
+    cv::UMatData* allocate(int dims, const int* sizes, int type, void* data,
+                           size_t* step, cv::AccessFlag flags,
+                           cv::UMatUsageFlags usage_flags) const;
+    bool allocate(cv::UMatData* data, cv::AccessFlag access_flags,
+                  cv::UMatUsageFlags usage_flags) const;
+
+    /**
+     * @brief Called by OpenCV once the last `cv::Mat` referring to a buffer
+     * is released
+     *
+     */
+    void deallocate(cv::UMatData* data) const;
+  };
+
+  Device* device;
+
+ public:
+  /**
+   * @brief Construct a new V4L2Source object and start capturing
+   *
+   * @param path Path of the device, e.g. `/dev/video0`
+   * @param width Requested frame width; the driver may pick another
+   * @param height Requested frame height; the driver may pick another
+   * @throw `std::runtime_error` if the device cannot be opened or does not
+   * support streaming YUYV, NV12 or BGR24 frames
+   */
+  explicit V4L2Source(std::string path, uint32_t width = 640,
+                      uint32_t height = 480);
+
+  /**
+   * @brief Stop capturing
+   *
+   * Frames that are still in use stay valid until they are released.
+   *
+   */
+  ~V4L2Source();
+
+  V4L2Source(const V4L2Source&) = delete;
+  V4L2Source& operator=(const V4L2Source&) = delete;
+
+  bool grab(void);
+  bool retrieve(cv::Mat* frame);
+  PixelFormat pixel_format(void);
+};
+
+}  // namespace FrameSource
+
+#endif  // SRC_V4L2_SOURCE_H_
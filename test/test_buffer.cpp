@@ -0,0 +1,391 @@
+#include <boost/test/unit_test.hpp>
+#include <atomic>
+#include <chrono>  //NOLINT [build/c++11]
+#include <stdexcept>
+#include <thread>  //NOLINT [build/c++11]
+#include <vector>
+
+#include "../src/buffer.h"
+
+#define BUFFER_SIZE 4
+
+struct Element {
+  uint64_t id;
+  int value;
+};
+
+BOOST_AUTO_TEST_CASE(RingElementsPoppedInOrder) {
+  Buffer::SequencedRing<Element> ring(BUFFER_SIZE);
+
+  std::vector<std::thread> producers;
+  for (int i = BUFFER_SIZE - 1; i >= 0; i--) {
+    producers.push_back(std::thread([&ring, i] {
+      ring.push(Element{static_cast<uint64_t>(i), i * 10});
+    }));
+  }
+
+  for (int i = 0; i < BUFFER_SIZE; i++) {
+    auto result = ring.pop();
+    BOOST_TEST(result.valid);
+    BOOST_CHECK_EQUAL(result.value.id, i);
+    BOOST_CHECK_EQUAL(result.value.value, i * 10);
+  }
+
+  for (auto& t : producers) {
+    t.join();
+  }
+}
+
+BOOST_AUTO_TEST_CASE(RingStressManyProducers) {
+  const int num_producers = 16;
+  const int num_elements = 50000;
+  Buffer::SequencedRing<Element> ring(BUFFER_SIZE);
+
+  // Producer `p` pushes every `num_producers`th element starting from `p`, so
+  // consecutive elements always come from different threads
+  std::vector<std::thread> producers;
+  for (int p = 0; p < num_producers; p++) {
+    producers.push_back(std::thread([&ring, p] {
+      for (int i = p; i < num_elements; i += num_producers) {
+        ring.push(Element{static_cast<uint64_t>(i), i});
+      }
+    }));
+  }
+
+  bool in_order = true;
+  for (int i = 0; i < num_elements; i++) {
+    auto result = ring.pop();
+    in_order = in_order && result.valid && result.value.value == i;
+  }
+  BOOST_TEST(in_order);
+
+  for (auto& t : producers) {
+    t.join();
+  }
+}
+
+BOOST_AUTO_TEST_CASE(RingStopReleasesBlockedThreads) {
+  Buffer::SequencedRing<Element> ring(BUFFER_SIZE);
+
+  // The consumer has nothing to pop and the producer's slot is still occupied
+  // by an element one lap behind
+  ring.push(Element{0, 0});
+  std::thread consumer([&ring] {
+    BOOST_TEST(ring.pop().valid);
+    BOOST_TEST(!ring.pop().valid);
+  });
+  std::thread producer([&ring] { ring.push(Element{BUFFER_SIZE + 1, 1}); });
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  ring.stop();
+
+  consumer.join();
+  producer.join();
+}
+
+BOOST_AUTO_TEST_CASE(RingMissingElementReleasedByWindow) {
+  Buffer::SequencedRing<Element> ring(BUFFER_SIZE, Buffer::ReorderWindow{2, 0});
+
+  // Element 0 never arrives; element 2 is two steps ahead so 0 is lost
+  ring.push(Element{1, 1});
+  ring.push(Element{2, 2});
+
+  auto result = ring.pop();
+  BOOST_TEST(result.valid);
+  BOOST_CHECK_EQUAL(result.value.id, 1);
+  BOOST_CHECK_EQUAL(ring.stats().lost, 1);
+
+  // Pushing the lost element afterwards must not block, and it is discarded
+  ring.push(Element{0, 0});
+  BOOST_CHECK_EQUAL(ring.stats().late, 1);
+
+  result = ring.pop();
+  BOOST_TEST(result.valid);
+  BOOST_CHECK_EQUAL(result.value.id, 2);
+  BOOST_CHECK_EQUAL(ring.stats().popped, 2);
+}
+
+BOOST_AUTO_TEST_CASE(RingMissingElementReleasedByTimeout) {
+  const size_t timeout_ms = 50;
+  Buffer::SequencedRing<Element> ring(BUFFER_SIZE,
+                                      Buffer::ReorderWindow{0, timeout_ms});
+
+  auto start = std::chrono::steady_clock::now();
+  ring.push(Element{1, 1});
+
+  auto result = ring.pop();
+  auto waited = std::chrono::steady_clock::now() - start;
+
+  BOOST_TEST(result.valid);
+  BOOST_CHECK_EQUAL(result.value.id, 1);
+  BOOST_CHECK_EQUAL(ring.stats().lost, 1);
+  BOOST_TEST((waited >= std::chrono::milliseconds(timeout_ms)));
+}
+
+BOOST_AUTO_TEST_CASE(RingLateElementWithinTimeoutNotLost) {
+  Buffer::SequencedRing<Element> ring(BUFFER_SIZE,
+                                      Buffer::ReorderWindow{0, 1000});
+
+  ring.push(Element{1, 1});
+  std::thread producer([&ring] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    ring.push(Element{0, 0});
+  });
+
+  BOOST_CHECK_EQUAL(ring.pop().value.id, 0);
+  BOOST_CHECK_EQUAL(ring.pop().value.id, 1);
+  BOOST_CHECK_EQUAL(ring.stats().lost, 0);
+  producer.join();
+}
+
+BOOST_AUTO_TEST_CASE(RingAbandonedElementSkipped) {
+  // Without a window the consumer would wait for 0 forever
+  Buffer::SequencedRing<Element> ring(2);
+
+  ring.push(Element{1, 1});
+  ring.abandon(0);
+  BOOST_CHECK_EQUAL(ring.pop().value.id, 1);
+  BOOST_CHECK_EQUAL(ring.stats().lost, 1);
+
+  // Abandoned while its slot still holds the previous lap
+  ring.push(Element{3, 3});
+  ring.abandon(4);
+  ring.push(Element{2, 2});
+  BOOST_CHECK_EQUAL(ring.pop().value.id, 2);
+  BOOST_CHECK_EQUAL(ring.pop().value.id, 3);
+  ring.push(Element{5, 5});
+  BOOST_CHECK_EQUAL(ring.pop().value.id, 5);
+  BOOST_CHECK_EQUAL(ring.stats().lost, 2);
+  BOOST_CHECK_EQUAL(ring.stats().late, 0);
+}
+
+BOOST_AUTO_TEST_CASE(RingDropNewestPolicy) {
+  Buffer::SequencedRing<Element> ring(2, Buffer::ReorderWindow{0, 0},
+                                      Buffer::DropNewest);
+
+  ring.push(Element{0, 0});
+  ring.push(Element{1, 1});
+  BOOST_CHECK_EQUAL(ring.stats().occupancy, 2);
+
+  // Slot for 2 still holds 0, so 2 is dropped without blocking
+  ring.push(Element{2, 2});
+  BOOST_CHECK_EQUAL(ring.stats().dropped, 1);
+
+  BOOST_CHECK_EQUAL(ring.pop().value.id, 0);
+  BOOST_CHECK_EQUAL(ring.pop().value.id, 1);
+
+  // The consumer skips the dropped element straight away
+  ring.push(Element{3, 3});
+  BOOST_CHECK_EQUAL(ring.pop().value.id, 3);
+  BOOST_CHECK_EQUAL(ring.stats().lost, 0);
+  BOOST_CHECK_EQUAL(ring.stats().occupancy, 0);
+}
+
+BOOST_AUTO_TEST_CASE(RingDropOldestPolicy) {
+  Buffer::SequencedRing<Element> ring(2, Buffer::ReorderWindow{0, 0},
+                                      Buffer::DropOldest);
+
+  ring.push(Element{0, 0});
+  ring.push(Element{1, 1});
+  ring.push(Element{2, 2});  // Replaces 0
+  ring.push(Element{3, 3});  // Replaces 1
+  BOOST_CHECK_EQUAL(ring.stats().dropped, 2);
+  BOOST_CHECK_EQUAL(ring.stats().occupancy, 2);
+
+  BOOST_CHECK_EQUAL(ring.pop().value.id, 2);
+  BOOST_CHECK_EQUAL(ring.pop().value.id, 3);
+
+  // A late arrival of a replaced element is discarded
+  ring.push(Element{1, 1});
+  BOOST_CHECK_EQUAL(ring.stats().late, 1);
+}
+
+BOOST_AUTO_TEST_CASE(RingEvictingMissingElementCountsLost) {
+  Buffer::SequencedRing<Element> ring(2, Buffer::ReorderWindow{0, 0},
+                                      Buffer::KeepLatest);
+
+  // 0 never arrives before 2 takes its slot
+  ring.push(Element{1, 1});
+  ring.push(Element{2, 2});
+  BOOST_CHECK_EQUAL(ring.stats().lost, 1);
+  BOOST_CHECK_EQUAL(ring.stats().dropped, 0);
+
+  BOOST_CHECK_EQUAL(ring.pop().value.id, 2);
+  BOOST_CHECK_EQUAL(ring.stats().dropped, 1);  // 1, skipped for 2
+
+  // Arriving afterwards, it is late
+  ring.push(Element{0, 0});
+  BOOST_CHECK_EQUAL(ring.stats().late, 1);
+  BOOST_CHECK_EQUAL(ring.stats().lost, 1);
+}
+
+BOOST_AUTO_TEST_CASE(RingKeepLatestPolicy) {
+  Buffer::SequencedRing<Element> ring(BUFFER_SIZE, Buffer::ReorderWindow{0, 0},
+                                      Buffer::KeepLatest);
+
+  ring.push(Element{0, 0});
+  ring.push(Element{1, 1});
+  ring.push(Element{2, 2});
+
+  // Only the newest of the ready elements is returned
+  BOOST_CHECK_EQUAL(ring.pop().value.id, 2);
+  BOOST_CHECK_EQUAL(ring.stats().dropped, 2);
+  BOOST_CHECK_EQUAL(ring.stats().popped, 1);
+  BOOST_CHECK_EQUAL(ring.stats().occupancy, 0);
+}
+
+BOOST_AUTO_TEST_CASE(RingBlockPolicyCountsWaits) {
+  Buffer::SequencedRing<Element> ring(1);
+
+  ring.push(Element{0, 0});
+  std::thread producer([&ring] { ring.push(Element{1, 1}); });
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  BOOST_CHECK_EQUAL(ring.pop().value.id, 0);
+  BOOST_CHECK_EQUAL(ring.pop().value.id, 1);
+  producer.join();
+
+  BOOST_CHECK_EQUAL(ring.stats().producer_waits, 1);
+  BOOST_CHECK_EQUAL(ring.stats().dropped, 0);
+}
+
+BOOST_AUTO_TEST_CASE(RingStressKeepLatest) {
+  const int num_producers = 16;
+  const int num_elements = 50000;
+  Buffer::SequencedRing<Element> ring(BUFFER_SIZE, Buffer::ReorderWindow{0, 0},
+                                      Buffer::KeepLatest);
+
+  std::vector<std::thread> producers;
+  for (int p = 0; p < num_producers; p++) {
+    producers.push_back(std::thread([&ring, p] {
+      for (int i = p; i < num_elements; i += num_producers) {
+        ring.push(Element{static_cast<uint64_t>(i), i});
+      }
+    }));
+  }
+
+  // Elements may be skipped but must never go backwards
+  int previous = -1;
+  bool in_order = true;
+  while (previous != num_elements - 1) {
+    auto result = ring.pop();
+    in_order = in_order && result.valid && result.value.value > previous;
+    previous = result.value.value;
+  }
+  BOOST_TEST(in_order);
+
+  for (auto& t : producers) {
+    t.join();
+  }
+  auto stats = ring.stats();
+  BOOST_CHECK_EQUAL(stats.popped + stats.dropped + stats.late, num_elements);
+}
+
+BOOST_AUTO_TEST_CASE(LatestSlotReturnsNewestValue) {
+  Buffer::LatestSlot<int> slot(1);
+
+  BOOST_CHECK_EQUAL(slot.read(), 0);
+  slot.publish(1);
+  slot.publish(2);
+  BOOST_CHECK_EQUAL(slot.read(), 2);
+  BOOST_CHECK_EQUAL(slot.read(), 2);
+  slot.publish(3);
+  BOOST_CHECK_EQUAL(slot.read(), 3);
+}
+
+BOOST_AUTO_TEST_CASE(LatestSlotStressManyReaders) {
+  const int num_readers = 8;
+  const int num_values = 200000;
+  // Every element holds the same number, so a torn read is easy to detect
+  Buffer::LatestSlot<std::vector<int>> slot(num_readers);
+  slot.publish(std::vector<int>(16, 0));
+
+  std::atomic<bool> done(false);
+  std::atomic<int> errors(0);
+  std::vector<std::thread> readers;
+  for (int r = 0; r < num_readers; r++) {
+    readers.push_back(std::thread([&slot, &done, &errors] {
+      int previous = 0;
+      while (!done) {
+        auto value = slot.read();
+        bool consistent = value.size() == 16;
+        for (auto v : value) {
+          consistent = consistent && v == value.front();
+        }
+        // Values must never go backwards for a single reader
+        if (!consistent || value.front() < previous) {
+          errors++;
+        }
+        previous = value.front();
+      }
+    }));
+  }
+
+  for (int i = 1; i <= num_values; i++) {
+    slot.publish(std::vector<int>(16, i));
+  }
+  done = true;
+  for (auto& t : readers) {
+    t.join();
+  }
+
+  BOOST_CHECK_EQUAL(errors.load(), 0);
+  BOOST_CHECK_EQUAL(slot.read().front(), num_values);
+}
+
+BOOST_AUTO_TEST_CASE(PoolHandlesReturnObjects) {
+  Buffer::Pool<int> pool(2);
+  int* first;
+  {
+    auto a = pool.acquire();
+    auto b = pool.acquire();
+    *a = 1;
+    first = &*a;
+    BOOST_CHECK_EQUAL(pool.stats().in_use, 2);
+
+    // Moving keeps the object checked out
+    auto c = std::move(a);
+    BOOST_CHECK_EQUAL(*c, 1);
+    BOOST_CHECK_EQUAL(pool.stats().in_use, 2);
+  }
+  auto stats = pool.stats();
+  BOOST_CHECK_EQUAL(stats.capacity, 2);
+  BOOST_CHECK_EQUAL(stats.in_use, 0);
+  BOOST_CHECK_EQUAL(stats.high_water, 2);
+  BOOST_CHECK_EQUAL(stats.waits, 0);
+
+  // Objects are reused, not reset
+  auto d = pool.acquire();
+  auto e = pool.acquire();
+  BOOST_TEST((&*d == first || &*e == first));
+  BOOST_TEST((*d == 1 || *e == 1));
+}
+
+BOOST_AUTO_TEST_CASE(PoolReturnsObjectOnException) {
+  Buffer::Pool<int> pool(1);
+  try {
+    auto handle = pool.acquire();
+    throw std::runtime_error("Failed");
+  } catch (const std::runtime_error&) {
+  }
+  BOOST_CHECK_EQUAL(pool.stats().in_use, 0);
+}
+
+BOOST_AUTO_TEST_CASE(PoolAcquireWaitsForRelease) {
+  Buffer::Pool<int> pool(1);
+  std::atomic<bool> acquired(false);
+  std::thread t;
+  {
+    auto handle = pool.acquire();
+    t = std::thread([&] {
+      auto other = pool.acquire();
+      acquired = true;
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    BOOST_TEST(!acquired);
+  }
+  t.join();
+  BOOST_TEST(acquired);
+  BOOST_CHECK_EQUAL(pool.stats().waits, 1);
+  BOOST_CHECK_EQUAL(pool.stats().high_water, 1);
+}
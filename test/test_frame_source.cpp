@@ -0,0 +1,82 @@
+#include <boost/test/unit_test.hpp>
+#include <chrono>  //NOLINT [build/c++11]
+#include <vector>
+
+#include "../src/frame_source.h"
+#ifdef __linux__
+#include "../src/v4l2_source.h"
+#endif
+#include "opencv2/opencv.hpp"
+
+BOOST_AUTO_TEST_CASE(SyntheticReplaysFramesInLoop) {
+  auto frames = FrameSource::Synthetic::noise(cv::Size(16, 8), 3);
+  FrameSource::Synthetic source(frames, 0);
+
+  for (int i = 0; i < 7; i++) {
+    cv::Mat frame;
+    BOOST_TEST(source.read(&frame));
+    BOOST_TEST(frame.data == frames.at(i % 3).data);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(SyntheticRetrievesLastGrabbedFrame) {
+  auto frames = FrameSource::Synthetic::noise(cv::Size(16, 8), 3);
+  FrameSource::Synthetic source(frames, 0);
+
+  // Frames that are grabbed but never retrieved are skipped
+  BOOST_TEST(source.grab());
+  BOOST_TEST(source.grab());
+
+  cv::Mat frame;
+  BOOST_TEST(source.retrieve(&frame));
+  BOOST_TEST(frame.data == frames.at(1).data);
+  BOOST_TEST(source.read(&frame));
+  BOOST_TEST(frame.data == frames.at(2).data);
+}
+
+BOOST_AUTO_TEST_CASE(SyntheticKeepsFrameRate) {
+  const size_t frame_delay_ms = 20;
+  FrameSource::Synthetic source(
+      FrameSource::Synthetic::noise(cv::Size(16, 8), 1), frame_delay_ms);
+
+  cv::Mat frame;
+  source.read(&frame);
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < 5; i++) {
+    source.read(&frame);
+  }
+  auto elapsed = std::chrono::steady_clock::now() - start;
+
+  BOOST_TEST((elapsed >= std::chrono::milliseconds(5 * frame_delay_ms - 1)));
+}
+
+BOOST_AUTO_TEST_CASE(SyntheticRejectsNoFrames) {
+  BOOST_CHECK_THROW(FrameSource::Synthetic(std::vector<cv::Mat>(), 0),
+                    std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(ImageSequenceLoadsImages) {
+  FrameSource::ImageSequence source("../../test/*.jpg", 0);
+  cv::Mat expected = cv::imread("../../test/test_image.jpg");
+
+  cv::Mat frame;
+  BOOST_TEST(source.read(&frame));
+  BOOST_CHECK_EQUAL(frame.rows, expected.rows);
+  BOOST_CHECK_EQUAL(frame.cols, expected.cols);
+}
+
+BOOST_AUTO_TEST_CASE(ImageSequenceRejectsNoMatches) {
+  BOOST_CHECK_THROW(FrameSource::ImageSequence("../../test/*.none", 0),
+                    std::invalid_argument);
+}
+
+#ifdef __linux__
+BOOST_AUTO_TEST_CASE(V4L2SourceRejectsMissingDevice) {
+  BOOST_CHECK_THROW(FrameSource::V4L2Source("/dev/no_such_camera"),
+                    std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(V4L2SourceRejectsNonCameraDevice) {
+  BOOST_CHECK_THROW(FrameSource::V4L2Source("/dev/null"), std::runtime_error);
+}
+#endif
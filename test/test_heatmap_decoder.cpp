@@ -0,0 +1,409 @@
+#include <math.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <boost/test/unit_test.hpp>
+#include <vector>
+
+#include "../src/heatmap_decoder.h"
+#include "../src/intermediate_structures.h"
+
+#define WIDTH 28
+#define HEIGHT 40  ///< Tall enough to hold every body part, see below
+#define EPSILON 1e-6
+
+/**
+ * @brief A heatmap of random values in [-0.5..0.5], with some ties
+ *
+ */
+std::vector<float> random_heatmap(size_t num_pixels) {
+  std::vector<float> heatmap(num_pixels * HEATMAP_CHANNELS);
+  for (auto& value : heatmap) {
+    value = (rand() % 64) / 64.0f - 0.5f;  // NOLINT [runtime/threadsafe_fn]
+  }
+  return heatmap;
+}
+
+BOOST_AUTO_TEST_CASE(ArgmaxKernelsAgree) {
+  auto heatmap = random_heatmap(WIDTH * HEIGHT);
+  float expected_max[HEATMAP_CHANNELS];
+  uint32_t expected_index[HEATMAP_CHANNELS];
+  Inference::argmax(Inference::ArgmaxScalar, heatmap.data(), WIDTH * HEIGHT,
+                    expected_max, expected_index);
+
+  Inference::ArgmaxKernel kernels[] = {
+      Inference::ArgmaxSSE41, Inference::ArgmaxAVX2, Inference::ArgmaxNEON};
+  for (auto kernel : kernels) {
+    if (!Inference::argmax_supported(kernel)) {
+      continue;
+    }
+    float max[HEATMAP_CHANNELS];
+    uint32_t index[HEATMAP_CHANNELS];
+    Inference::argmax(kernel, heatmap.data(), WIDTH * HEIGHT, max, index);
+    for (int c = 0; c < HEATMAP_CHANNELS; c++) {
+      BOOST_TEST(max[c] == expected_max[c]);
+      BOOST_TEST(index[c] == expected_index[c]);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(ArgmaxFirstOfTies) {
+  std::vector<float> heatmap(WIDTH * HEIGHT * HEATMAP_CHANNELS, 0.25f);
+  float max[HEATMAP_CHANNELS];
+  uint32_t index[HEATMAP_CHANNELS];
+  Inference::argmax(heatmap.data(), WIDTH * HEIGHT, max, index);
+  for (int c = 0; c < HEATMAP_CHANNELS; c++) {
+    BOOST_TEST(max[c] == 0.25f);
+    BOOST_TEST(index[c] == 0);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(ArgmaxIgnoresNonPositive) {
+  std::vector<float> heatmap(WIDTH * HEIGHT * HEATMAP_CHANNELS, -1.0f);
+  heatmap[5 * HEATMAP_CHANNELS + 3] = 0.5f;
+  float max[HEATMAP_CHANNELS];
+  uint32_t index[HEATMAP_CHANNELS];
+  Inference::argmax(heatmap.data(), WIDTH * HEIGHT, max, index);
+  for (int c = 0; c < HEATMAP_CHANNELS; c++) {
+    BOOST_TEST(max[c] == (c == 3 ? 0.5f : 0.0f));
+    BOOST_TEST(index[c] == (c == 3 ? 5 : 0));
+  }
+}
+
+BOOST_AUTO_TEST_CASE(ArgmaxQuantisedKernelsAgree) {
+  std::vector<uint8_t> heatmap(WIDTH * HEIGHT * HEATMAP_CHANNELS);
+  for (auto& value : heatmap) {
+    value = rand() % 64 * 4;  // NOLINT [runtime/threadsafe_fn]
+  }
+
+  struct {
+    TensorType type;
+    int32_t zero_point;
+  } quantisations[] = {{UInt8Tensor, 100}, {Int8Tensor, -20}};
+  Inference::ArgmaxKernel kernels[] = {
+      Inference::ArgmaxScalar, Inference::ArgmaxSSE41, Inference::ArgmaxAVX2,
+      Inference::ArgmaxNEON};
+  for (auto quantisation : quantisations) {
+    // An odd number of pixels too, for the kernels that take several at once
+    for (size_t num_pixels = WIDTH * HEIGHT - 1; num_pixels <= WIDTH * HEIGHT;
+         num_pixels++) {
+      int32_t expected_max[HEATMAP_CHANNELS];
+      uint32_t expected_index[HEATMAP_CHANNELS];
+      for (int c = 0; c < HEATMAP_CHANNELS; c++) {
+        expected_max[c] = quantisation.zero_point;
+        expected_index[c] = 0;
+        for (size_t p = 0; p < num_pixels; p++) {
+          uint8_t bits = heatmap[p * HEATMAP_CHANNELS + c];
+          int32_t value = quantisation.type == UInt8Tensor
+                              ? bits
+                              : static_cast<int8_t>(bits);
+          if (value > expected_max[c]) {
+            expected_max[c] = value;
+            expected_index[c] = p;
+          }
+        }
+      }
+
+      for (auto kernel : kernels) {
+        if (!Inference::argmax_supported(kernel)) {
+          continue;
+        }
+        int32_t max[HEATMAP_CHANNELS];
+        uint32_t index[HEATMAP_CHANNELS];
+        Inference::argmax_quantised(kernel, heatmap.data(), num_pixels,
+                                    quantisation.type,
+                                    quantisation.zero_point, max, index);
+        for (int c = 0; c < HEATMAP_CHANNELS; c++) {
+          BOOST_TEST(max[c] == expected_max[c]);
+          BOOST_TEST(index[c] == expected_index[c]);
+        }
+      }
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(OnlyBodyPartsOfJointsUsed) {
+  for (int joint = JointMin; joint <= JointMax; joint++) {
+    for (size_t i = 0; i < joint_body_parts[joint].count; i++) {
+      BOOST_TEST(body_part_used(joint_body_parts[joint].body_parts[i]));
+    }
+  }
+  BOOST_TEST(!body_part_used(right_elbow));
+  BOOST_TEST(!body_part_used(left_elbow));
+  BOOST_TEST(!body_part_used(right_wrist));
+  BOOST_TEST(!body_part_used(left_wrist));
+  BOOST_TEST(!body_part_used(thorax));
+}
+
+BOOST_AUTO_TEST_CASE(DecodedPositionsRelative) {
+  std::vector<float> heatmap(WIDTH * HEIGHT * HEATMAP_CHANNELS, 0.0f);
+  // Each body part at (body part, 2 * body part)
+  for (int body_part = BodyPartMin; body_part <= BodyPartMax; body_part++) {
+    size_t pixel = 2 * body_part * WIDTH + body_part;
+    heatmap[pixel * HEATMAP_CHANNELS + body_part] = 0.9f;
+  }
+
+  auto results = Inference::decode_heatmap(heatmap.data(), WIDTH, HEIGHT);
+  for (int body_part = BodyPartMin; body_part <= BodyPartMax; body_part++) {
+    auto coordinate = results.body_parts[body_part];
+    if (!body_part_used(body_part)) {
+      // Not decoded
+      BOOST_TEST(coordinate.confidence == 0.0f);
+      continue;
+    }
+    BOOST_TEST(coordinate.x == static_cast<float>(body_part) / WIDTH,
+               boost::test_tools::tolerance(EPSILON));
+    BOOST_TEST(coordinate.y == static_cast<float>(2 * body_part) / HEIGHT,
+               boost::test_tools::tolerance(EPSILON));
+    BOOST_TEST(coordinate.confidence == 0.9f);
+  }
+}
+
+/**
+ * @brief A heatmap with a single smooth peak in every channel at (`x`, `y`)
+ *
+ * Falls off quadratically, so a parabola fits it exactly
+ *
+ */
+std::vector<float> peak_heatmap(float x, float y) {
+  std::vector<float> heatmap(WIDTH * HEIGHT * HEATMAP_CHANNELS);
+  for (size_t py = 0; py < HEIGHT; py++) {
+    for (size_t px = 0; px < WIDTH; px++) {
+      float value = 1 - 0.05 * ((px - x) * (px - x) + (py - y) * (py - y));
+      for (int c = 0; c < HEATMAP_CHANNELS; c++) {
+        heatmap[(py * WIDTH + px) * HEATMAP_CHANNELS + c] = value;
+      }
+    }
+  }
+  return heatmap;
+}
+
+BOOST_AUTO_TEST_CASE(QuadraticRefinementBetweenPixels) {
+  auto heatmap = peak_heatmap(10.3, 20.8);
+  auto whole_pixels = Inference::decode_heatmap(heatmap.data(), WIDTH, HEIGHT);
+  auto refined = Inference::decode_heatmap(heatmap.data(), WIDTH, HEIGHT,
+                                           Inference::QuadraticRefinement);
+  for (int body_part = BodyPartMin; body_part <= BodyPartMax; body_part++) {
+    if (!body_part_used(body_part)) continue;
+    BOOST_TEST(whole_pixels.body_parts[body_part].x == 10.0f / WIDTH,
+               boost::test_tools::tolerance(EPSILON));
+    BOOST_TEST(whole_pixels.body_parts[body_part].y == 21.0f / HEIGHT,
+               boost::test_tools::tolerance(EPSILON));
+    BOOST_TEST(refined.body_parts[body_part].x == 10.3f / WIDTH,
+               boost::test_tools::tolerance(1e-4));
+    BOOST_TEST(refined.body_parts[body_part].y == 20.8f / HEIGHT,
+               boost::test_tools::tolerance(1e-4));
+    BOOST_TEST(refined.body_parts[body_part].confidence ==
+               whole_pixels.body_parts[body_part].confidence);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(SoftArgmaxRefinementBetweenPixels) {
+  // Symmetric about the middle of two pixels
+  std::vector<float> heatmap(WIDTH * HEIGHT * HEATMAP_CHANNELS, 0.0f);
+  heatmap[(5 * WIDTH + 7) * HEATMAP_CHANNELS] = 0.8f;
+  heatmap[(5 * WIDTH + 8) * HEATMAP_CHANNELS] = 0.8f;
+  heatmap[(4 * WIDTH + 7) * HEATMAP_CHANNELS] = 0.2f;
+  heatmap[(6 * WIDTH + 7) * HEATMAP_CHANNELS] = 0.2f;
+  heatmap[(4 * WIDTH + 8) * HEATMAP_CHANNELS] = 0.2f;
+  heatmap[(6 * WIDTH + 8) * HEATMAP_CHANNELS] = 0.2f;
+
+  auto refined = Inference::decode_heatmap(heatmap.data(), WIDTH, HEIGHT,
+                                           Inference::SoftArgmaxRefinement);
+  BOOST_TEST(refined.body_parts[0].x == 7.5f / WIDTH,
+             boost::test_tools::tolerance(EPSILON));
+  BOOST_TEST(refined.body_parts[0].y == 5.0f / HEIGHT,
+             boost::test_tools::tolerance(EPSILON));
+  BOOST_TEST(refined.body_parts[0].confidence == 0.8f);
+}
+
+BOOST_AUTO_TEST_CASE(RefinementStaysWithinHeatmap) {
+  auto heatmap = peak_heatmap(-3, HEIGHT + 3);
+  Inference::Refinement refinements[] = {Inference::QuadraticRefinement,
+                                         Inference::SoftArgmaxRefinement};
+  for (auto refinement : refinements) {
+    auto refined =
+        Inference::decode_heatmap(heatmap.data(), WIDTH, HEIGHT, refinement);
+    for (auto& body_part : refined.body_parts) {
+      BOOST_TEST(body_part.x >= 0.0f);
+      BOOST_TEST(body_part.y <= (HEIGHT - 1.0f) / HEIGHT + EPSILON);
+    }
+  }
+}
+
+/**
+ * @brief A heatmap of low noise with a Gaussian peak for each body part
+ *
+ * Body part `c` is centred on (`x` + `c`, `y` + `c`)
+ *
+ */
+std::vector<float> pose_heatmap(float x, float y, size_t width = WIDTH,
+                                size_t height = HEIGHT) {
+  std::vector<float> heatmap(width * height * HEATMAP_CHANNELS);
+  for (size_t py = 0; py < height; py++) {
+    for (size_t px = 0; px < width; px++) {
+      for (int c = 0; c < HEATMAP_CHANNELS; c++) {
+        float dx = px - (x + c);
+        float dy = py - (y + c);
+        heatmap[(py * width + px) * HEATMAP_CHANNELS + c] =
+            0.9f * expf(-(dx * dx + dy * dy) / 8) +
+            (rand() % 50) / 1000.0f;  // NOLINT [runtime/threadsafe_fn]
+      }
+    }
+  }
+  return heatmap;
+}
+
+bool same_results(const Inference::InferenceResults& a,
+                  const Inference::InferenceResults& b) {
+  for (int body_part = BodyPartMin; body_part <= BodyPartMax; body_part++) {
+    if (a.body_parts[body_part].x != b.body_parts[body_part].x ||
+        a.body_parts[body_part].y != b.body_parts[body_part].y ||
+        a.body_parts[body_part].confidence !=
+            b.body_parts[body_part].confidence) {
+      return false;
+    }
+  }
+  return true;
+}
+
+BOOST_AUTO_TEST_CASE(LocalSearchMatchesFullSearch) {
+  Inference::HeatmapDecoder decoder(
+      WIDTH, HEIGHT, Inference::QuadraticRefinement,
+      Inference::LocalSearch{4, 0.5, 1000});
+  int full_scans = 0;
+  // The user drifts by less than the window from one frame to the next
+  for (int frame = 0; frame < 20; frame++) {
+    auto heatmap = pose_heatmap(2 + 0.3 * frame, 1 + 0.2 * frame);
+    auto expected = Inference::decode_heatmap(heatmap.data(), WIDTH, HEIGHT,
+                                              Inference::QuadraticRefinement);
+    BOOST_TEST(same_results(decoder.decode(heatmap.data()), expected));
+    full_scans += decoder.last_was_full_scan();
+  }
+  BOOST_TEST(full_scans == 1);
+}
+
+BOOST_AUTO_TEST_CASE(LocalSearchTiesWithinWindow) {
+  Inference::HeatmapDecoder decoder(WIDTH, HEIGHT, Inference::NoRefinement,
+                                    Inference::LocalSearch{4, 0.5, 1000});
+  auto heatmap = pose_heatmap(2, 1);
+  decoder.decode(heatmap.data());
+
+  // The peak of the head, at (2, 1), also occurs earlier outside its window
+  float peak = 0;
+  for (size_t pixel = 0; pixel < WIDTH * HEIGHT; pixel++) {
+    peak = std::max(peak, heatmap[pixel * HEATMAP_CHANNELS + head_top]);
+  }
+  heatmap[20 * HEATMAP_CHANNELS + head_top] = peak;
+
+  auto local = decoder.decode(heatmap.data());
+  auto full = Inference::decode_heatmap(heatmap.data(), WIDTH, HEIGHT);
+  BOOST_TEST(!decoder.last_was_full_scan());
+
+  // The same value, at the pixel within the window
+  BOOST_TEST(local.body_parts[head_top].confidence ==
+             full.body_parts[head_top].confidence);
+  BOOST_TEST(full.body_parts[head_top].x * WIDTH >= 20);
+  BOOST_TEST(local.body_parts[head_top].x * WIDTH < 2 + 4 + 1);
+}
+
+BOOST_AUTO_TEST_CASE(FullSearchWhenUserMoves) {
+  Inference::HeatmapDecoder decoder(WIDTH, HEIGHT, Inference::NoRefinement,
+                                    Inference::LocalSearch{4, 0.5, 1000});
+  decoder.decode(pose_heatmap(2, 1).data());
+
+  // Too far for the windows, which now only hold noise
+  auto heatmap = pose_heatmap(10, 20);
+  auto results = decoder.decode(heatmap.data());
+  BOOST_TEST(decoder.last_was_full_scan());
+  BOOST_TEST(same_results(
+      results, Inference::decode_heatmap(heatmap.data(), WIDTH, HEIGHT)));
+}
+
+BOOST_AUTO_TEST_CASE(FullSearchPeriodically) {
+  Inference::HeatmapDecoder decoder(WIDTH, HEIGHT, Inference::NoRefinement,
+                                    Inference::LocalSearch{4, 0.5, 5});
+  auto heatmap = pose_heatmap(2, 1);
+  int full_scans = 0;
+  for (int frame = 0; frame < 20; frame++) {
+    decoder.decode(heatmap.data());
+    full_scans += decoder.last_was_full_scan();
+  }
+  BOOST_TEST(full_scans == 4);
+}
+
+BOOST_AUTO_TEST_CASE(LocalSearchFollowsRegion) {
+  Inference::HeatmapDecoder decoder(WIDTH, HEIGHT, Inference::NoRefinement,
+                                    Inference::LocalSearch{4, 0.5, 1000});
+  auto heatmap = pose_heatmap(2, 1);
+  decoder.decode(heatmap.data(), PreProcessing::Region{0.5, 0.5, 0.5, 0.5});
+
+  // The same part of the frame, shifted within the new region
+  auto shifted = pose_heatmap(3, 2);
+  PreProcessing::Region region{0.5f - 1.0f / WIDTH * 0.5f,
+                               0.5f - 1.0f / HEIGHT * 0.5f, 0.5, 0.5};
+  auto results = decoder.decode(shifted.data(), region);
+  BOOST_TEST(!decoder.last_was_full_scan());
+  BOOST_TEST(same_results(
+      results, Inference::decode_heatmap(shifted.data(), WIDTH, HEIGHT)));
+
+  // Body parts last found outside of the region
+  decoder.decode(shifted.data(), PreProcessing::Region{0, 0, 0.25, 0.25});
+  BOOST_TEST(decoder.last_was_full_scan());
+}
+
+BOOST_AUTO_TEST_CASE(LocalSearchCarriesOverResize) {
+  Inference::HeatmapDecoder decoder(WIDTH, HEIGHT, Inference::NoRefinement,
+                                    Inference::LocalSearch{4, 0.5, 1000});
+  decoder.decode(pose_heatmap(2, 1).data());
+
+  // Body parts move by a few pixels of the larger heatmap
+  decoder.resize(WIDTH + 4, HEIGHT + 4);
+  auto heatmap = pose_heatmap(2, 1, WIDTH + 4, HEIGHT + 4);
+  auto results = decoder.decode(heatmap.data());
+  BOOST_TEST(!decoder.last_was_full_scan());
+  BOOST_TEST(same_results(results, Inference::decode_heatmap(
+                                       heatmap.data(), WIDTH + 4, HEIGHT + 4)));
+}
+
+BOOST_AUTO_TEST_CASE(UnusedBodyPartsNotSearched) {
+  Inference::HeatmapDecoder decoder(WIDTH, HEIGHT, Inference::NoRefinement,
+                                    Inference::LocalSearch{4, 0.5, 1000});
+  auto heatmap = pose_heatmap(2, 1);
+  decoder.decode(heatmap.data());
+
+  // Body parts no joint is derived from are lost, which must not cause a
+  // full search
+  for (size_t pixel = 0; pixel < WIDTH * HEIGHT; pixel++) {
+    for (int c = 0; c < HEATMAP_CHANNELS; c++) {
+      if (!body_part_used(c)) {
+        heatmap[pixel * HEATMAP_CHANNELS + c] = 0;
+      }
+    }
+  }
+  decoder.decode(heatmap.data());
+  BOOST_TEST(!decoder.last_was_full_scan());
+}
+
+BOOST_AUTO_TEST_CASE(QuantisedHeatmapDecodedAsFloat) {
+  auto heatmap = pose_heatmap(5.3, 7.6);
+  Quantisation quantisation{1.0f / 255, 0};
+  std::vector<uint8_t> quantised(heatmap.size());
+  std::vector<float> dequantised(heatmap.size());
+  for (size_t i = 0; i < heatmap.size(); i++) {
+    quantised[i] = std::min(lrintf(heatmap[i] * 255), 255L);
+    dequantised[i] =
+        quantisation.scale * (quantised[i] - quantisation.zero_point);
+  }
+
+  Inference::HeatmapDecoder decoder(WIDTH, HEIGHT,
+                                    Inference::QuadraticRefinement,
+                                    Inference::LocalSearch{4, 0.5, 1000});
+  for (int frame = 0; frame < 2; frame++) {
+    auto results = decoder.decode(
+        Inference::Heatmap{quantised.data(), UInt8Tensor, quantisation});
+    BOOST_TEST(same_results(
+        results, Inference::decode_heatmap(dequantised.data(), WIDTH, HEIGHT,
+                                           Inference::QuadraticRefinement)));
+  }
+}
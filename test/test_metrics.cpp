@@ -0,0 +1,122 @@
+#include <stdio.h>
+
+#include <boost/test/unit_test.hpp>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>  //NOLINT [build/c++11]
+#include <vector>
+
+#include "../src/metrics.h"
+
+#define METRICS_FILE "test_metrics.json"
+
+std::string read_file(const char* path) {
+  std::ifstream file(path);
+  std::stringstream contents;
+  contents << file.rdbuf();
+  return contents.str();
+}
+
+BOOST_AUTO_TEST_CASE(SameNameSameMetric) {
+  BOOST_TEST(&Metrics::counter("same") == &Metrics::counter("same"));
+  BOOST_TEST(&Metrics::counter("same") != &Metrics::counter("other"));
+  BOOST_TEST(&Metrics::gauge("same") == &Metrics::gauge("same"));
+  BOOST_TEST(&Metrics::histogram("same") == &Metrics::histogram("same"));
+}
+
+BOOST_AUTO_TEST_CASE(CounterCountsFromManyThreads) {
+  auto& counter = Metrics::counter("threads");
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; t++) {
+    threads.push_back(std::thread([&] {
+      for (int i = 0; i < 10000; i++) {
+        counter.add();
+      }
+    }));
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  BOOST_CHECK_EQUAL(counter.get(), 40000);
+}
+
+BOOST_AUTO_TEST_CASE(GaugeHoldsLastValue) {
+  auto& gauge = Metrics::gauge("last");
+  gauge.set(1.5);
+  gauge.set(2.5);
+  BOOST_CHECK_EQUAL(gauge.get(), 2.5);
+}
+
+BOOST_AUTO_TEST_CASE(EmptyHistogram) {
+  Metrics::Histogram histogram;
+  BOOST_CHECK_EQUAL(histogram.get_count(), 0);
+  BOOST_CHECK_EQUAL(histogram.get_mean(), 0);
+  BOOST_CHECK_EQUAL(histogram.get_percentile(50), 0);
+}
+
+BOOST_AUTO_TEST_CASE(SmallValuesExact) {
+  Metrics::Histogram histogram;
+  for (uint64_t v = 0; v < HISTOGRAM_SUB_BUCKETS; v++) {
+    histogram.record(v);
+  }
+  BOOST_CHECK_EQUAL(histogram.get_percentile(0), 0);
+  BOOST_CHECK_EQUAL(histogram.get_percentile(50), 7);
+  BOOST_CHECK_EQUAL(histogram.get_percentile(100), 15);
+  BOOST_CHECK_EQUAL(histogram.get_max(), 15);
+  BOOST_CHECK_EQUAL(histogram.get_mean(), 7.5);
+}
+
+BOOST_AUTO_TEST_CASE(PercentilesWithinBucketError) {
+  Metrics::Histogram histogram;
+  for (uint64_t v = 1; v <= 100000; v++) {
+    histogram.record(v);
+  }
+  BOOST_CHECK_EQUAL(histogram.get_count(), 100000);
+  BOOST_CHECK_EQUAL(histogram.get_max(), 100000);
+
+  double percentiles[] = {1, 50, 90, 99, 99.9};
+  for (double p : percentiles) {
+    double exact = p * 1000;
+    double estimate = histogram.get_percentile(p);
+    // Never below the true value, and at most one bucket above it
+    BOOST_TEST(estimate >= exact);
+    BOOST_TEST(estimate <= exact * (1 + 1.0 / HISTOGRAM_SUB_BUCKETS));
+  }
+  BOOST_CHECK_EQUAL(histogram.get_percentile(100), 100000);
+}
+
+BOOST_AUTO_TEST_CASE(LargestValues) {
+  Metrics::Histogram histogram;
+  histogram.record(UINT64_MAX);
+  BOOST_CHECK_EQUAL(histogram.get_percentile(50), UINT64_MAX);
+}
+
+BOOST_AUTO_TEST_CASE(SnapshotContainsAllMetrics) {
+  Metrics::counter("snapshot.counter").add(3);
+  Metrics::gauge("snapshot.gauge").set(0.5);
+  Metrics::histogram("snapshot.histogram").record(10);
+
+  std::string snapshot = Metrics::snapshot();
+  BOOST_TEST(snapshot.find("\"snapshot.counter\":3") != std::string::npos);
+  BOOST_TEST(snapshot.find("\"snapshot.gauge\":0.5") != std::string::npos);
+  BOOST_TEST(snapshot.find("\"snapshot.histogram\":{\"count\":1,") !=
+             std::string::npos);
+  BOOST_TEST(snapshot.find("\"p99\":10") != std::string::npos);
+}
+
+BOOST_AUTO_TEST_CASE(DumperWritesFinalSnapshot) {
+  remove(METRICS_FILE);
+  Metrics::counter("dumped").add();
+  { Metrics::Dumper dumper(METRICS_FILE); }
+  BOOST_TEST(read_file(METRICS_FILE).find("\"dumped\":1") !=
+             std::string::npos);
+}
+
+BOOST_AUTO_TEST_CASE(DumperWritesPeriodically) {
+  remove(METRICS_FILE);
+  Metrics::Dumper dumper(METRICS_FILE, 10);
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  BOOST_TEST(read_file(METRICS_FILE).find("\"counters\"") !=
+             std::string::npos);
+}
@@ -0,0 +1,61 @@
+#include <boost/test/unit_test.hpp>
+#include <chrono>  //NOLINT [build/c++11]
+#include <stdexcept>
+#include <vector>
+
+#include "../src/buffer.h"
+#include "../src/intermediate_structures.h"
+#include "../src/pipeline.h"
+
+/**
+ * @brief Stands in for an `Inference::InferenceCore` whose model fails to run
+ *
+ */
+struct FailingCore {
+  std::vector<Inference::InferenceResults> run_batch(
+      size_t count, const PreProcessing::Region* regions,
+      const uint64_t* frames) {
+    throw std::runtime_error("Could not run the model");
+  }
+};
+
+/**
+ * @brief Stands in for an `Inference::InferenceCore` that runs its model
+ *
+ */
+struct WorkingCore {
+  std::vector<Inference::InferenceResults> run_batch(
+      size_t count, const PreProcessing::Region* regions,
+      const uint64_t* frames) {
+    return std::vector<Inference::InferenceResults>(count);
+  }
+};
+
+std::vector<Pipeline::RawFrame> frames(uint64_t first, uint64_t count) {
+  std::vector<Pipeline::RawFrame> frames;
+  for (uint64_t id = first; id < first + count; id++) {
+    frames.push_back(Pipeline::RawFrame{id, cv::Mat(),
+                                        std::chrono::steady_clock::now()});
+  }
+  return frames;
+}
+
+BOOST_AUTO_TEST_CASE(FailedBatchAbandoned) {
+  Buffer::SequencedRing<Pipeline::CoreResults> results(4);
+  std::vector<PreProcessing::Region> regions(2,
+                                             PreProcessing::Region{0, 0, 1, 1});
+
+  FailingCore failing;
+  auto failed = frames(0, 2);
+  BOOST_TEST(!Pipeline::deliver_batch(&failing, &failed, regions, 0, &results));
+  BOOST_TEST(results.stats().occupancy == 0);
+  BOOST_TEST(results.stats().lost == 2);
+
+  // Nothing was emitted for the failed frames, so the following frames are
+  // popped straight away
+  WorkingCore working;
+  auto next = frames(2, 2);
+  BOOST_TEST(Pipeline::deliver_batch(&working, &next, regions, 0, &results));
+  BOOST_TEST(results.pop().value.id == 2);
+  BOOST_TEST(results.pop().value.id == 3);
+}
@@ -1,5 +1,12 @@
+#include <math.h>
+#include <string.h>
+
+#include <algorithm>
 #include <boost/test/unit_test.hpp>
+#include <stdexcept>
+#include <vector>
 
+#include "../src/normalise.h"
 #include "../src/pre_processor.h"
 #include "opencv2/opencv.hpp"
 
@@ -9,13 +16,18 @@
 
 bool check_normalised(float value) { return value <= 1.0 && value >= -1.0; }
 
+// Stands in for the model's input tensor
+std::vector<float> input_tensor(
+    MODEL_INPUT_X * MODEL_INPUT_Y * MODEL_NUM_CHANNELS);
+
 BOOST_AUTO_TEST_CASE(ImageNormalised) {
   cv::Mat image = cv::imread("../../test/test_image.jpg");
 
   PreProcessing::PreProcessor pre_proc =
       PreProcessing::PreProcessor(MODEL_INPUT_X, MODEL_INPUT_Y);
 
-  PreProcessing::PreProcessedImage pre_proc_img = pre_proc.run(image);
+  PreProcessing::PreProcessedImage pre_proc_img{input_tensor.data()};
+  pre_proc.run(image, pre_proc_img);
 
   // Check image has been normalised to range [-1..1]
   for (int i = 0; i < MODEL_INPUT_X * MODEL_INPUT_Y * MODEL_NUM_CHANNELS;
@@ -30,7 +42,8 @@ BOOST_AUTO_TEST_CASE(RBChannelsSwitched) {
   PreProcessing::PreProcessor pre_proc =
       PreProcessing::PreProcessor(MODEL_INPUT_X, MODEL_INPUT_Y);
 
-  PreProcessing::PreProcessedImage pre_proc_img = pre_proc.run(image);
+  PreProcessing::PreProcessedImage pre_proc_img{input_tensor.data()};
+  pre_proc.run(image, pre_proc_img);
 
   // Manually resize and normalise to compare R and B channels
   cv::resize(image, image, cv::Size(MODEL_INPUT_X, MODEL_INPUT_Y));
@@ -50,10 +63,124 @@ BOOST_AUTO_TEST_CASE(RBChannelsSwitched) {
     non_switched_img[i + 2] = img[2] / 127.5 - 1;
   }
 
-  // Check channels have been switched
+  // Check channels have been switched. Resizing may round differently from
+  // OpenCV, by at most one level
+  float tolerance = 1 / 127.5 + 1e-6;
   for (int i = 0; i < size * step; i += step) {
-    BOOST_TEST(pre_proc_img.image[i + 0], non_switched_img[i + 2]);
-    BOOST_TEST(pre_proc_img.image[i + 1], non_switched_img[i + 1]);
-    BOOST_TEST(pre_proc_img.image[i + 2], non_switched_img[i + 0]);
+    BOOST_TEST(fabs(pre_proc_img.image[i + 0] - non_switched_img[i + 2]) <=
+               tolerance);
+    BOOST_TEST(fabs(pre_proc_img.image[i + 1] - non_switched_img[i + 1]) <=
+               tolerance);
+    BOOST_TEST(fabs(pre_proc_img.image[i + 2] - non_switched_img[i + 0]) <=
+               tolerance);
+  }
+  free(non_switched_img);
+}
+
+BOOST_AUTO_TEST_CASE(ModelSizedImageOnlyNormalised) {
+  cv::Mat image(MODEL_INPUT_Y, MODEL_INPUT_X, CV_8UC3);
+  cv::randu(image, cv::Scalar::all(0), cv::Scalar::all(256));
+
+  PreProcessing::PreProcessor pre_proc(MODEL_INPUT_X, MODEL_INPUT_Y);
+  pre_proc.run(image, PreProcessing::PreProcessedImage{input_tensor.data()});
+
+  std::vector<float> expected(input_tensor.size());
+  PreProcessing::normalise(PreProcessing::NormaliseScalar, image.data,
+                           expected.data(), MODEL_INPUT_X * MODEL_INPUT_Y);
+  BOOST_TEST(input_tensor == expected);
+}
+
+BOOST_AUTO_TEST_CASE(QuantisedImageMatchesNormalised) {
+  cv::Mat image(MODEL_INPUT_Y, MODEL_INPUT_X, CV_8UC3);
+  cv::randu(image, cv::Scalar::all(0), cv::Scalar::all(256));
+  std::vector<float> normalised(input_tensor.size());
+  PreProcessing::normalise(PreProcessing::NormaliseScalar, image.data,
+                           normalised.data(), MODEL_INPUT_X * MODEL_INPUT_Y);
+
+  PreProcessing::PreProcessor pre_proc(MODEL_INPUT_X, MODEL_INPUT_Y);
+  std::vector<uint8_t> quantised(input_tensor.size());
+  PreProcessing::PreProcessedImage destinations[] = {
+      {nullptr, quantised.data(), UInt8Tensor, Quantisation{1.0f / 128, 128}},
+      {nullptr, quantised.data(), Int8Tensor, Quantisation{0.01f, -3}}};
+  for (auto destination : destinations) {
+    pre_proc.run(image, destination);
+    int32_t min = destination.type == UInt8Tensor ? 0 : -128;
+    int32_t max = destination.type == UInt8Tensor ? 255 : 127;
+    for (size_t i = 0; i < quantised.size(); i++) {
+      int32_t expected =
+          lrintf(normalised[i] / destination.quantisation.scale) +
+          destination.quantisation.zero_point;
+      expected = std::min(std::max(expected, min), max);
+      int32_t value = destination.type == UInt8Tensor
+                          ? quantised[i]
+                          : static_cast<int8_t>(quantised[i]);
+      BOOST_TEST(value == expected);
+    }
+  }
+
+  uint8_t table[256];
+  BOOST_CHECK_THROW(
+      PreProcessing::quantise_table(Float32Tensor, Quantisation{1, 0}, table),
+      std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(ScratchMemoryReturnedToPool) {
+  cv::Mat image = cv::imread("../../test/test_image.jpg");
+  PreProcessing::PreProcessor pre_proc(MODEL_INPUT_X, MODEL_INPUT_Y, 2);
+  for (int i = 0; i < 3; i++) {
+    pre_proc.run(image, PreProcessing::PreProcessedImage{input_tensor.data()});
+  }
+
+  auto stats = pre_proc.scratch_stats();
+  BOOST_CHECK_EQUAL(stats.capacity, 2);
+  BOOST_CHECK_EQUAL(stats.in_use, 0);
+  BOOST_CHECK_EQUAL(stats.high_water, 1);
+}
+
+BOOST_AUTO_TEST_CASE(NonBGRImageRejected) {
+  cv::Mat image(MODEL_INPUT_Y, MODEL_INPUT_X, CV_8UC1);
+  PreProcessing::PreProcessor pre_proc(MODEL_INPUT_X, MODEL_INPUT_Y);
+  BOOST_CHECK_THROW(
+      pre_proc.run(image,
+                   PreProcessing::PreProcessedImage{input_tensor.data()}),
+      std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(NormaliseKernelsBitExact) {
+  // Every value in every channel, with the pixel count varied so that the
+  // kernels' remainders are covered
+  std::vector<uint8_t> bgr;
+  for (int i = 0; i < 3 * 256 + 2; i++) {
+    bgr.push_back(i % 256);
+    bgr.push_back((i * 7 + 85) % 256);
+    bgr.push_back((255 - i) % 256);
+  }
+
+  // The original scalar implementation
+  size_t max_pixels = bgr.size() / 3;
+  std::vector<float> expected(bgr.size());
+  for (size_t i = 0; i < bgr.size(); i += 3) {
+    expected[i + 0] = bgr[i + 2] / 127.5 - 1;
+    expected[i + 1] = bgr[i + 1] / 127.5 - 1;
+    expected[i + 2] = bgr[i + 0] / 127.5 - 1;
+  }
+
+  PreProcessing::NormaliseKernel kernels[] = {
+      PreProcessing::NormaliseScalar, PreProcessing::NormaliseSSE41,
+      PreProcessing::NormaliseAVX2, PreProcessing::NormaliseNEON};
+  for (auto kernel : kernels) {
+    if (!PreProcessing::normalise_supported(kernel)) {
+      continue;
+    }
+    for (size_t num_pixels = max_pixels - 40; num_pixels <= max_pixels;
+         num_pixels++) {
+      // Poison the output to catch anything not written
+      std::vector<float> rgb(bgr.size() + 1, 2);
+      PreProcessing::normalise(kernel, bgr.data(), rgb.data(), num_pixels);
+      BOOST_TEST(memcmp(rgb.data(), expected.data(),
+                        num_pixels * 3 * sizeof(float)) == 0,
+                 "kernel " << kernel << ", " << num_pixels << " pixels");
+      BOOST_TEST(rgb[num_pixels * 3] == 2);
+    }
   }
 }
@@ -0,0 +1,108 @@
+#include <boost/test/unit_test.hpp>
+#include <stdexcept>
+#include <vector>
+
+#include "../src/qos_governor.h"
+
+/**
+ * @brief Variants of 4, 2 and 1 times the cost of the cheapest
+ *
+ */
+std::vector<QoS::Variant> variants(void) {
+  return std::vector<QoS::Variant>{QoS::Variant{"model.tflite", 224, 224, 4},
+                                   QoS::Variant{"model.tflite", 160, 160, 2},
+                                   QoS::Variant{"model.tflite", 112, 112, 1}};
+}
+
+/**
+ * @brief Pass `frames` frames of `latency_ms` to `governor`
+ *
+ * @return `size_t` The variant chosen after the last frame
+ */
+size_t feed(QoS::Governor* governor, int frames, double latency_ms,
+            double budget_ms) {
+  size_t variant = governor->get_current();
+  for (int i = 0; i < frames; i++) {
+    variant = governor->update(latency_ms, budget_ms);
+  }
+  return variant;
+}
+
+BOOST_AUTO_TEST_CASE(StartsAtMostExpensive) {
+  QoS::Governor governor(variants());
+  BOOST_TEST(governor.get_current() == 0);
+  BOOST_TEST(governor.get_variants().size() == 3);
+}
+
+BOOST_AUTO_TEST_CASE(StepsDownWhenBudgetMissed) {
+  QoS::Governor governor(variants(), 5, 0.7, 1);
+  BOOST_TEST(feed(&governor, 4, 150, 100) == 0);
+  BOOST_TEST(feed(&governor, 1, 150, 100) == 1);
+
+  // Measured afresh after the switch
+  BOOST_TEST(feed(&governor, 4, 150, 100) == 1);
+  BOOST_TEST(feed(&governor, 1, 150, 100) == 2);
+
+  // Never beyond the cheapest
+  BOOST_TEST(feed(&governor, 20, 150, 100) == 2);
+}
+
+BOOST_AUTO_TEST_CASE(BriefSpikesIgnored) {
+  QoS::Governor governor(variants(), 5, 0.7, 1);
+  for (int i = 0; i < 10; i++) {
+    feed(&governor, 4, 150, 100);
+    BOOST_TEST(feed(&governor, 1, 90, 100) == 0);
+  }
+
+  // Smoothing absorbs a single spike entirely
+  QoS::Governor smoothed(variants(), 1, 0.7, 0.2);
+  feed(&smoothed, 10, 80, 100);
+  BOOST_TEST(feed(&smoothed, 1, 150, 100) == 0);
+}
+
+BOOST_AUTO_TEST_CASE(StepsUpWithHeadroom) {
+  QoS::Governor governor(variants(), 5, 0.7, 1);
+  feed(&governor, 10, 150, 100);
+  BOOST_TEST(governor.get_current() == 2);
+
+  // 40ms would be predicted to take 80ms at twice the cost, too close to the
+  // budget
+  BOOST_TEST(feed(&governor, 20, 40, 100) == 2);
+
+  // 30ms would be predicted to take 60ms
+  BOOST_TEST(feed(&governor, 5, 30, 100) == 1);
+  BOOST_TEST(feed(&governor, 5, 30, 100) == 0);
+  BOOST_TEST(feed(&governor, 20, 10, 100) == 0);
+}
+
+BOOST_AUTO_TEST_CASE(FollowsBudget) {
+  QoS::Governor governor(variants(), 5, 0.7, 1);
+  BOOST_TEST(feed(&governor, 5, 150, 200) == 0);
+  BOOST_TEST(feed(&governor, 5, 150, 100) == 1);
+}
+
+BOOST_AUTO_TEST_CASE(BudgetCoversFramesInFlight) {
+  BOOST_TEST(QoS::latency_budget(125, 8) == 1000);
+  BOOST_TEST(QoS::latency_budget(125, 2 * 4) == 1000);
+
+  // 8 single threaded cores at 8Hz take several frame delays for each frame,
+  // yet keep up
+  QoS::Governor governor(variants());
+  BOOST_TEST(feed(&governor, 100, 600, QoS::latency_budget(125, 8)) == 0);
+
+  // Only stepping down once they no longer can
+  BOOST_TEST(feed(&governor, 100, 1200, QoS::latency_budget(125, 8)) == 2);
+}
+
+BOOST_AUTO_TEST_CASE(InvalidVariants) {
+  BOOST_CHECK_THROW(QoS::Governor{std::vector<QoS::Variant>()},
+                    std::invalid_argument);
+
+  auto increasing = variants();
+  increasing[2].cost = 8;
+  BOOST_CHECK_THROW(QoS::Governor{increasing}, std::invalid_argument);
+
+  auto costless = variants();
+  costless[2].cost = 0;
+  BOOST_CHECK_THROW(QoS::Governor{costless}, std::invalid_argument);
+}
@@ -0,0 +1,146 @@
+#include <stdlib.h>
+
+#include <boost/test/unit_test.hpp>
+#include <stdexcept>
+#include <vector>
+
+#include "../src/resample.h"
+#include "opencv2/opencv.hpp"
+
+#define WIDTH 8
+#define HEIGHT 6
+
+/**
+ * @brief Fill a frame with random bytes
+ *
+ */
+cv::Mat random_frame(int rows, int cols, int type) {
+  cv::Mat frame(rows, cols, type);
+  cv::randu(frame, cv::Scalar::all(0), cv::Scalar::all(256));
+  return frame;
+}
+
+/**
+ * @brief Check every byte of `a` is within `tolerance` of `b`
+ *
+ */
+bool close(const cv::Mat& a, const cv::Mat& b, int tolerance) {
+  if (a.size() != b.size() || a.type() != b.type()) {
+    return false;
+  }
+  for (int y = 0; y < a.rows; y++) {
+    for (int x = 0; x < a.cols * a.channels(); x++) {
+      if (abs(a.ptr<uint8_t>(y)[x] - b.ptr<uint8_t>(y)[x]) > tolerance) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+BOOST_AUTO_TEST_CASE(SameSizeBGRUnchanged) {
+  cv::Mat frame = random_frame(HEIGHT, WIDTH, CV_8UC3);
+  PreProcessing::Resampler resampler;
+  cv::Mat bgr = resampler.resample(frame, FrameSource::BGR,
+                                   frame.size(), FrameSource::BGR);
+  BOOST_TEST(close(bgr, frame, 0));
+
+  cv::Mat rgb = resampler.resample(frame, FrameSource::BGR, frame.size(),
+                                   FrameSource::RGB);
+  cv::Mat expected;
+  cv::cvtColor(frame, expected, cv::COLOR_BGR2RGB);
+  BOOST_TEST(close(rgb, expected, 0));
+}
+
+BOOST_AUTO_TEST_CASE(ResizeMatchesOpenCV) {
+  cv::Mat frame = random_frame(48, 64, CV_8UC3);
+  PreProcessing::Resampler resampler;
+  cv::Mat resized = resampler.resample(frame, FrameSource::BGR,
+                                       cv::Size(24, 20), FrameSource::BGR);
+
+  cv::Mat expected;
+  cv::resize(frame, expected, cv::Size(24, 20), 0, 0, cv::INTER_LINEAR);
+  BOOST_TEST(close(resized, expected, 1));
+}
+
+BOOST_AUTO_TEST_CASE(YUYVMatchesOpenCV) {
+  cv::Mat frame = random_frame(HEIGHT, WIDTH, CV_8UC2);
+  PreProcessing::Resampler resampler;
+  cv::Mat rgb = resampler.resample(frame, FrameSource::YUYV, frame.size(),
+                                   FrameSource::RGB);
+
+  cv::Mat expected;
+  cv::cvtColor(frame, expected, cv::COLOR_YUV2RGB_YUYV);
+  BOOST_TEST(close(rgb, expected, 1));
+}
+
+BOOST_AUTO_TEST_CASE(NV12MatchesOpenCV) {
+  cv::Mat frame = random_frame(HEIGHT * 3 / 2, WIDTH, CV_8UC1);
+  PreProcessing::Resampler resampler;
+  BOOST_TEST((PreProcessing::Resampler::frame_size(frame, FrameSource::NV12) ==
+              cv::Size(WIDTH, HEIGHT)));
+  cv::Mat bgr = resampler.resample(frame, FrameSource::NV12,
+                                   cv::Size(WIDTH, HEIGHT), FrameSource::BGR);
+
+  cv::Mat expected;
+  cv::cvtColor(frame, expected, cv::COLOR_YUV2BGR_NV12);
+  BOOST_TEST(close(bgr, expected, 1));
+}
+
+BOOST_AUTO_TEST_CASE(YUVConvertedAfterResizing) {
+  // Converting after resizing must match resizing after converting. Colours
+  // are kept within RGB so that clamping does not make the conversion
+  // non-linear
+  cv::Mat frame(48, 64, CV_8UC2);
+  cv::randu(frame, cv::Scalar(60, 108), cv::Scalar(191, 149));
+  PreProcessing::Resampler resampler;
+  cv::Mat small = resampler.resample(frame, FrameSource::YUYV,
+                                     cv::Size(16, 12), FrameSource::BGR);
+
+  cv::Mat converted;
+  cv::cvtColor(frame, converted, cv::COLOR_YUV2BGR_YUYV);
+  cv::Mat expected = resampler.resample(converted, FrameSource::BGR,
+                                        cv::Size(16, 12), FrameSource::BGR);
+  BOOST_TEST(close(small, expected, 3));
+}
+
+BOOST_AUTO_TEST_CASE(RegionMatchesCroppedFrame) {
+  cv::Rect region(10, 8, 32, 24);
+  PreProcessing::Resampler resampler;
+
+  cv::Mat bgr = random_frame(48, 64, CV_8UC3);
+  cv::Mat cropped = resampler.resample(bgr(region).clone(), FrameSource::BGR,
+                                       cv::Size(16, 12), FrameSource::RGB);
+  resampler.start(bgr, FrameSource::BGR, cv::Size(16, 12), region);
+  cv::Mat resampled(12, 16, CV_8UC3);
+  for (int y = 0; y < resampled.rows; y++) {
+    resampler.row(y, resampled.ptr<uint8_t>(y), FrameSource::RGB);
+  }
+  BOOST_TEST(close(resampled, cropped, 0));
+
+  cv::Mat yuyv = random_frame(48, 64, CV_8UC2);
+  cropped = resampler.resample(yuyv(region).clone(), FrameSource::YUYV,
+                               cv::Size(16, 12), FrameSource::BGR);
+  resampler.start(yuyv, FrameSource::YUYV, cv::Size(16, 12), region);
+  for (int y = 0; y < resampled.rows; y++) {
+    resampler.row(y, resampled.ptr<uint8_t>(y), FrameSource::BGR);
+  }
+  BOOST_TEST(close(resampled, cropped, 0));
+
+  BOOST_CHECK_THROW(resampler.start(bgr, FrameSource::BGR, cv::Size(16, 12),
+                                    cv::Rect(40, 8, 32, 24)),
+                    std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(FormatMismatchRejected) {
+  PreProcessing::Resampler resampler;
+  cv::Mat bgr = random_frame(HEIGHT, WIDTH, CV_8UC3);
+  BOOST_CHECK_THROW(resampler.start(bgr, FrameSource::YUYV, bgr.size()),
+                    std::invalid_argument);
+
+  // NV12 needs both planes
+  cv::Mat luma_only = random_frame(HEIGHT, WIDTH, CV_8UC1);
+  BOOST_CHECK_THROW(
+      resampler.start(luma_only, FrameSource::NV12, luma_only.size()),
+      std::invalid_argument);
+}
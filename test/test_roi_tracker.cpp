@@ -0,0 +1,86 @@
+#include <boost/test/unit_test.hpp>
+
+#include "../src/intermediate_structures.h"
+#include "../src/roi_tracker.h"
+
+#define EPSILON 1e-5
+
+/**
+ * @brief Results with only `joints` trustworthy, at the given positions
+ *
+ */
+PostProcessing::ProcessedResults results(int joints, float left, float top,
+                                         float right, float bottom) {
+  PostProcessing::ProcessedResults results;
+  for (int j = JointMin; j <= JointMax; j++) {
+    // Alternate between the corners of the bounding box
+    results.body_parts[j] = PostProcessing::Coordinate{
+        j % 2 ? right : left, j % 2 ? bottom : top,
+        j < joints ? PostProcessing::Trustworthy
+                   : PostProcessing::Untrustworthy};
+  }
+  return results;
+}
+
+bool whole_frame(PreProcessing::Region region) {
+  return region.x == 0 && region.y == 0 && region.width == 1 &&
+         region.height == 1;
+}
+
+BOOST_AUTO_TEST_CASE(WholeFrameUntilTracked) {
+  PreProcessing::RoiTracker tracker;
+  BOOST_TEST(whole_frame(tracker.next()));
+
+  // Too few joints to track
+  tracker.update(results(1, 0.4, 0.4, 0.6, 0.6));
+  BOOST_TEST(whole_frame(tracker.next()));
+}
+
+BOOST_AUTO_TEST_CASE(RegionAroundUser) {
+  PreProcessing::RoiTracker tracker(0.25);
+  tracker.update(results(JointMax + 1, 0.4, 0.3, 0.6, 0.7));
+  auto region = tracker.next();
+
+  // Square about the centre, with a margin of a quarter of the larger side
+  BOOST_TEST(region.width == 0.6, boost::test_tools::tolerance(EPSILON));
+  BOOST_TEST(region.height == 0.6, boost::test_tools::tolerance(EPSILON));
+  BOOST_TEST(region.x == 0.2, boost::test_tools::tolerance(EPSILON));
+  BOOST_TEST(region.y == 0.2, boost::test_tools::tolerance(EPSILON));
+}
+
+BOOST_AUTO_TEST_CASE(RegionWithinFrame) {
+  PreProcessing::RoiTracker tracker(0.25);
+  tracker.update(results(JointMax + 1, 0.0, 0.7, 0.2, 1.0));
+  auto region = tracker.next();
+  BOOST_TEST(region.x == 0);
+  BOOST_TEST(region.y + region.height <= 1.0 + EPSILON);
+  BOOST_TEST(region.width >= ROI_MIN_SIZE);
+
+  // Never larger than the frame
+  tracker.update(results(JointMax + 1, 0.0, 0.0, 1.0, 1.0));
+  BOOST_TEST(whole_frame(tracker.next()));
+}
+
+BOOST_AUTO_TEST_CASE(WholeFramePeriodically) {
+  PreProcessing::RoiTracker tracker(0.25, 4);
+  tracker.update(results(JointMax + 1, 0.4, 0.4, 0.6, 0.6));
+  int whole_frames = 0;
+  for (int i = 0; i < 12; i++) {
+    whole_frames += whole_frame(tracker.next());
+  }
+  BOOST_TEST(whole_frames == 3);
+}
+
+BOOST_AUTO_TEST_CASE(ResultsMappedToFrame) {
+  Inference::InferenceResults results;
+  for (auto& body_part : results.body_parts) {
+    body_part = Inference::Coordinate{0.5, 1.0, 0.8};
+  }
+  auto mapped = PreProcessing::RoiTracker::to_frame(
+      PreProcessing::Region{0.2, 0.1, 0.4, 0.5}, results);
+  for (auto& body_part : mapped.body_parts) {
+    BOOST_TEST(body_part.x == 0.4, boost::test_tools::tolerance(EPSILON));
+    BOOST_TEST(body_part.y == 0.6, boost::test_tools::tolerance(EPSILON));
+    BOOST_TEST(body_part.confidence == 0.8f);
+  }
+}
@@ -0,0 +1,51 @@
+#include <boost/test/unit_test.hpp>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include "../src/trace.h"
+
+#define TRACE_FILE "test_trace.json"
+
+std::string read_file(const char* path) {
+  std::ifstream file(path);
+  std::stringstream contents;
+  contents << file.rdbuf();
+  return contents.str();
+}
+
+BOOST_AUTO_TEST_CASE(EventsWrittenInChromeFormat) {
+  BOOST_TEST(Trace::start(TRACE_FILE));
+  BOOST_TEST(!Trace::start(TRACE_FILE));
+  BOOST_TEST(Trace::enabled());
+
+  Trace::name_thread("Test");
+  { Trace::Span span("Stage", 42); }
+  Trace::instant("Point", 43);
+  BOOST_TEST(Trace::stop());
+  BOOST_TEST(!Trace::enabled());
+
+  std::string trace = read_file(TRACE_FILE);
+  BOOST_TEST(trace.find("\"traceEvents\"") != std::string::npos);
+  BOOST_TEST(trace.find("\"name\":\"Test\"") != std::string::npos);
+  BOOST_TEST(trace.find("\"name\":\"Stage\",\"ph\":\"X\"") !=
+             std::string::npos);
+  BOOST_TEST(trace.find("\"frame\":42") != std::string::npos);
+  BOOST_TEST(trace.find("\"name\":\"Point\",\"ph\":\"i\"") !=
+             std::string::npos);
+  BOOST_TEST(trace.find("\"frame\":43") != std::string::npos);
+}
+
+BOOST_AUTO_TEST_CASE(NothingRecordedWhenStopped) {
+  { Trace::Span span("Ignored", 1); }
+
+  BOOST_TEST(Trace::start(TRACE_FILE));
+  BOOST_TEST(Trace::stop());
+  BOOST_TEST(read_file(TRACE_FILE).find("Ignored") == std::string::npos);
+  BOOST_TEST(!Trace::stop());
+}
+
+BOOST_AUTO_TEST_CASE(FrameIsPerThread) {
+  Trace::set_frame(7);
+  BOOST_CHECK_EQUAL(Trace::frame(), 7);
+}